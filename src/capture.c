@@ -0,0 +1,271 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "capture.h"
+#include "delta.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void chip8_capture_put_u16(uint8_t *p, uint16_t value) {
+	p[0] = value;
+	p[1] = value >> 8;
+}
+
+static void chip8_capture_put_u32(uint8_t *p, uint32_t value) {
+	chip8_capture_put_u16(p, value);
+	chip8_capture_put_u16(&p[2], value >> 16);
+}
+
+static void chip8_capture_put_u64(uint8_t *p, uint64_t value) {
+	chip8_capture_put_u32(p, value);
+	chip8_capture_put_u32(&p[4], value >> 32);
+}
+
+static uint16_t chip8_capture_get_u16(const uint8_t *p) {
+	return p[0] | (p[1] << 8);
+}
+
+static uint32_t chip8_capture_get_u32(const uint8_t *p) {
+	return chip8_capture_get_u16(p) | ((uint32_t)chip8_capture_get_u16(&p[2]) << 16);
+}
+
+static uint64_t chip8_capture_get_u64(const uint8_t *p) {
+	return chip8_capture_get_u32(p) | ((uint64_t)chip8_capture_get_u32(&p[4]) << 32);
+}
+
+static void chip8_capture_put_header(uint8_t *header, uint32_t frame_count, uint64_t index_offset) {
+	memcpy(header, "C8CAPTUR", 8);
+	chip8_capture_put_u16(&header[8], CHIP8_CAPTURE_VERSION);
+	chip8_capture_put_u16(&header[10], CHIP8_CAPTURE_KEYFRAME_INTERVAL);
+	chip8_capture_put_u32(&header[12], frame_count);
+	chip8_capture_put_u64(&header[16], index_offset);
+}
+
+int chip8_capture_writer_open(struct chip8_capture_writer *writer, const char *path) {
+	memset(writer, 0, sizeof(*writer));
+	writer->fp = fopen(path, "wb");
+	if(writer->fp == NULL) {
+		return -1;
+	}
+	uint8_t header[CHIP8_CAPTURE_HEADER_SIZE];
+	chip8_capture_put_header(header, 0, 0);
+	if(fwrite(header, sizeof(header), 1, writer->fp) != 1) {
+		fclose(writer->fp);
+		writer->fp = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+int chip8_capture_writer_write(struct chip8_capture_writer *writer, const struct chip8_capture_frame *frame) {
+	static const uint8_t blank_display[sizeof(frame->display)];
+	uint8_t keyframe = (writer->frame_count % CHIP8_CAPTURE_KEYFRAME_INTERVAL) == 0;
+	uint8_t audio_changed = keyframe || memcmp(writer->previous.audio, frame->audio, sizeof(frame->audio));
+
+	if(keyframe) {
+		if(writer->index_count >= writer->index_capacity) {
+			size_t capacity = writer->index_capacity ? writer->index_capacity*2 : 64;
+			struct chip8_capture_index_entry *index = realloc(writer->index, capacity*sizeof(*index));
+			if(index == NULL) {
+				return -1;
+			}
+			writer->index = index;
+			writer->index_capacity = capacity;
+		}
+		writer->index[writer->index_count].frame = writer->frame_count;
+		writer->index[writer->index_count].offset = ftell(writer->fp);
+		writer->index_count++;
+	}
+
+	uint8_t record[4+CHIP8_AUDIO_BUFFER_SIZE+CHIP8_DELTA_MAX_SIZE];
+	size_t size = 4;
+	if(audio_changed) {
+		for(size_t n=0; n<CHIP8_AUDIO_BUFFER_SIZE/4; n++) {
+			// Big-endian, the same order as the pattern in the CHIP-8 memory
+			record[size++] = frame->audio[n] >> 24;
+			record[size++] = frame->audio[n] >> 16;
+			record[size++] = frame->audio[n] >> 8;
+			record[size++] = frame->audio[n];
+		}
+	}
+	size_t delta_size = chip8_delta_encode(keyframe ? blank_display : writer->previous.display, frame->display, &record[size]);
+	size += delta_size;
+
+	chip8_capture_put_u16(&record[0], delta_size);
+	record[2] = (keyframe ? CHIP8_CAPTURE_FLAG_KEYFRAME : 0) |
+				(frame->high_res ? CHIP8_CAPTURE_FLAG_HIGH_RES : 0) |
+				(frame->sound ? CHIP8_CAPTURE_FLAG_SOUND : 0) |
+				(audio_changed ? CHIP8_CAPTURE_FLAG_AUDIO : 0);
+	record[3] = frame->audio_pitch;
+	if(fwrite(record, size, 1, writer->fp) != 1) {
+		return -1;
+	}
+	writer->previous = *frame;
+	writer->frame_count++;
+	return 0;
+}
+
+int chip8_capture_writer_close(struct chip8_capture_writer *writer) {
+	int ret = 0;
+	uint64_t index_offset = ftell(writer->fp);
+	for(size_t n=0; n<writer->index_count; n++) {
+		uint8_t entry[12];
+		chip8_capture_put_u32(&entry[0], writer->index[n].frame);
+		chip8_capture_put_u64(&entry[4], writer->index[n].offset);
+		if(fwrite(entry, sizeof(entry), 1, writer->fp) != 1) {
+			ret = -1;
+		}
+	}
+	uint8_t header[CHIP8_CAPTURE_HEADER_SIZE];
+	chip8_capture_put_header(header, writer->frame_count, index_offset);
+	if(fseek(writer->fp, 0, SEEK_SET) || fwrite(header, sizeof(header), 1, writer->fp) != 1) {
+		ret = -1;
+	}
+	if(fclose(writer->fp)) {
+		ret = -1;
+	}
+	free(writer->index);
+	writer->fp = NULL;
+	writer->index = NULL;
+	return ret;
+}
+
+int chip8_capture_reader_open(struct chip8_capture_reader *reader, const char *path) {
+	memset(reader, 0, sizeof(*reader));
+	reader->fp = fopen(path, "rb");
+	if(reader->fp == NULL) {
+		return -1;
+	}
+	uint8_t header[CHIP8_CAPTURE_HEADER_SIZE];
+	if(fread(header, sizeof(header), 1, reader->fp) != 1 || memcmp(header, "C8CAPTUR", 8)
+		|| chip8_capture_get_u16(&header[8]) != CHIP8_CAPTURE_VERSION) {
+		chip8_capture_reader_close(reader);
+		return -1;
+	}
+	reader->frame_count = chip8_capture_get_u32(&header[12]);
+	uint64_t index_offset = chip8_capture_get_u64(&header[16]);
+	if(index_offset) {
+		// Without the index, the capture can still be read sequentially
+		if(fseek(reader->fp, 0, SEEK_END)) {
+			chip8_capture_reader_close(reader);
+			return -1;
+		}
+		reader->index_count = (ftell(reader->fp)-index_offset)/12;
+		reader->index = calloc(reader->index_count ? reader->index_count : 1, sizeof(*reader->index));
+		if(reader->index == NULL || fseek(reader->fp, index_offset, SEEK_SET)) {
+			chip8_capture_reader_close(reader);
+			return -1;
+		}
+		for(size_t n=0; n<reader->index_count; n++) {
+			uint8_t entry[12];
+			if(fread(entry, sizeof(entry), 1, reader->fp) != 1) {
+				chip8_capture_reader_close(reader);
+				return -1;
+			}
+			reader->index[n].frame = chip8_capture_get_u32(&entry[0]);
+			reader->index[n].offset = chip8_capture_get_u64(&entry[4]);
+		}
+	}
+	if(fseek(reader->fp, CHIP8_CAPTURE_HEADER_SIZE, SEEK_SET)) {
+		chip8_capture_reader_close(reader);
+		return -1;
+	}
+	return 0;
+}
+
+int chip8_capture_reader_read(struct chip8_capture_reader *reader, struct chip8_capture_frame *frame) {
+	if(reader->index && reader->next_frame >= reader->frame_count) {
+		return 0;
+	}
+	uint8_t record[4+CHIP8_AUDIO_BUFFER_SIZE+CHIP8_DELTA_MAX_SIZE];
+	if(fread(record, 4, 1, reader->fp) != 1) {
+		return feof(reader->fp) ? 0 : -1;
+	}
+	size_t delta_size = chip8_capture_get_u16(&record[0]);
+	uint8_t flags = record[2];
+	if(delta_size > CHIP8_DELTA_MAX_SIZE) {
+		return -1;
+	}
+	size_t size = delta_size + ((flags & CHIP8_CAPTURE_FLAG_AUDIO) ? CHIP8_AUDIO_BUFFER_SIZE : 0);
+	if(fread(&record[4], size, 1, reader->fp) != 1 && size) {
+		return -1;
+	}
+
+	struct chip8_capture_frame *current = &reader->current;
+	const uint8_t *p = &record[4];
+	if(flags & CHIP8_CAPTURE_FLAG_AUDIO) {
+		for(size_t n=0; n<CHIP8_AUDIO_BUFFER_SIZE/4; n++) {
+			current->audio[n] = ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+			p += 4;
+		}
+	}
+	if(flags & CHIP8_CAPTURE_FLAG_KEYFRAME) {
+		memset(current->display, 0, sizeof(current->display));
+	}
+	if(chip8_delta_apply(current->display, p, delta_size)) {
+		return -1;
+	}
+	current->audio_pitch = record[3];
+	current->high_res = !!(flags & CHIP8_CAPTURE_FLAG_HIGH_RES);
+	current->sound = !!(flags & CHIP8_CAPTURE_FLAG_SOUND);
+	reader->next_frame++;
+	*frame = *current;
+	return 1;
+}
+
+int chip8_capture_reader_seek(struct chip8_capture_reader *reader, uint32_t frame) {
+	uint32_t start_frame = 0;
+	uint64_t start_offset = CHIP8_CAPTURE_HEADER_SIZE;
+	for(size_t n=0; n<reader->index_count && reader->index[n].frame <= frame; n++) {
+		start_frame = reader->index[n].frame;
+		start_offset = reader->index[n].offset;
+	}
+	// Reading on from the current position is faster than restarting from the keyframe
+	if(reader->next_frame > frame || reader->next_frame <= start_frame) {
+		if(fseek(reader->fp, start_offset, SEEK_SET)) {
+			return -1;
+		}
+		reader->next_frame = start_frame;
+	}
+	struct chip8_capture_frame skipped;
+	while(reader->next_frame < frame) {
+		if(chip8_capture_reader_read(reader, &skipped) != 1) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+void chip8_capture_reader_close(struct chip8_capture_reader *reader) {
+	if(reader->fp) {
+		fclose(reader->fp);
+	}
+	free(reader->index);
+	reader->fp = NULL;
+	reader->index = NULL;
+}
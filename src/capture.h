@@ -0,0 +1,101 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CHIP8_CAPTURE_H
+#define CHIP8_CAPTURE_H
+
+// Gameplay capture file. All integers are little-endian.
+//
+// Header (CHIP8_CAPTURE_HEADER_SIZE bytes):
+//   magic "C8CAPTUR", version (2 bytes), keyframe interval (2 bytes), frame count (4 bytes),
+//   index offset (8 bytes). The last two are filled in on close, and are 0 if the capture wasn't closed properly.
+// Frame record, one per display frame:
+//   delta size (2 bytes), flags (1 byte, CHIP8_CAPTURE_FLAG_*), audio_pitch (1 byte),
+//   audio pattern (CHIP8_AUDIO_BUFFER_SIZE bytes, only if CHIP8_CAPTURE_FLAG_AUDIO), display delta (see delta.h).
+//   The delta of a keyframe is against a blank display, otherwise it's against the previous frame. Keyframes
+//   always carry the audio pattern, so decoding can start from any of them.
+// Index, after the last frame record:
+//   for each keyframe: frame number (4 bytes), file offset of the record (8 bytes)
+
+#include "chip8.h"
+#include <stdio.h>
+
+#define CHIP8_CAPTURE_VERSION (1U)
+#define CHIP8_CAPTURE_HEADER_SIZE (24U)
+#define CHIP8_CAPTURE_KEYFRAME_INTERVAL (60U)
+
+#define CHIP8_CAPTURE_FLAG_KEYFRAME (1U << 0)
+#define CHIP8_CAPTURE_FLAG_HIGH_RES (1U << 1)
+#define CHIP8_CAPTURE_FLAG_SOUND (1U << 2)
+#define CHIP8_CAPTURE_FLAG_AUDIO (1U << 3)
+
+struct chip8_capture_frame {
+	uint8_t display[CHIP8_DISPLAY_HEIGHT*CHIP8_DISPLAY_WIDTH/8];
+	uint32_t audio[CHIP8_AUDIO_BUFFER_SIZE/4];
+	uint8_t audio_pitch;
+	uint8_t high_res;
+	uint8_t sound;
+};
+
+struct chip8_capture_index_entry {
+	uint32_t frame;
+	uint64_t offset;
+};
+
+struct chip8_capture_writer {
+	FILE *fp;
+	uint32_t frame_count;
+	struct chip8_capture_frame previous;
+	struct chip8_capture_index_entry *index;
+	size_t index_count;
+	size_t index_capacity;
+};
+
+struct chip8_capture_reader {
+	FILE *fp;
+	uint32_t frame_count;
+	uint32_t next_frame;
+	struct chip8_capture_frame current;
+	struct chip8_capture_index_entry *index;
+	size_t index_count;
+};
+
+// All of these return 0 on success, -1 on error
+int chip8_capture_writer_open(struct chip8_capture_writer *writer, const char *path);
+int chip8_capture_writer_write(struct chip8_capture_writer *writer, const struct chip8_capture_frame *frame);
+int chip8_capture_writer_close(struct chip8_capture_writer *writer);
+
+int chip8_capture_reader_open(struct chip8_capture_reader *reader, const char *path);
+// Returns 1 if a frame is read, 0 at the end of the capture
+int chip8_capture_reader_read(struct chip8_capture_reader *reader, struct chip8_capture_frame *frame);
+// Positions the reader so that the next chip8_capture_reader_read() returns the given frame.
+// Jumps to the nearest keyframe via the index, if the capture has one.
+int chip8_capture_reader_seek(struct chip8_capture_reader *reader, uint32_t frame);
+void chip8_capture_reader_close(struct chip8_capture_reader *reader);
+
+#endif
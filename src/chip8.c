@@ -47,6 +47,100 @@ static void chip8_halt_cpu(struct chip8_machine *machine, uint32_t reasion_flag)
 	machine->periph.requests |= reasion_flag;
 }
 
+#ifdef CHIP8_DEBUGGER
+static void chip8_debug_break(struct chip8_machine *machine, uint8_t reason, uint16_t address) {
+	machine->debug.reason = reason;
+	machine->debug.address = address;
+	machine->debug.single_step = 0;
+	machine->debug.step_started = 0;
+	machine->debug.step_over = 0;
+	machine->debug.resume_pc_valid = 0;
+	machine->periph.requests |= CHIP8_REQUEST_DEBUG_BREAK;
+}
+
+// Breaks before the instruction at PC. Resuming runs it, rather than stopping at it again.
+static void chip8_debug_break_before(struct chip8_machine *machine, uint8_t reason, uint16_t pc) {
+	chip8_debug_break(machine, reason, pc);
+	machine->debug.resume_pc_valid = 1;
+	machine->debug.resume_pc = pc;
+}
+
+static uint8_t chip8_debug_check_condition(const struct chip8_debug_condition *condition, const uint8_t *v) {
+	switch(condition->op) {
+		case CHIP8_DEBUG_OP_EQUAL: return v[condition->reg] == condition->value;
+		case CHIP8_DEBUG_OP_NOT_EQUAL: return v[condition->reg] != condition->value;
+		case CHIP8_DEBUG_OP_LESS: return v[condition->reg] < condition->value;
+		case CHIP8_DEBUG_OP_GREATER: return v[condition->reg] > condition->value;
+		default: return 0;
+	}
+}
+
+// Returns 1 if the instruction at PC shouldn't be run
+static uint8_t chip8_debug_check_pc(struct chip8_machine *machine) {
+	struct chip8_debug *debug = &machine->debug;
+	uint16_t pc = machine->cpu.pc[machine->cpu.pc_index];
+	uint8_t resumed = debug->resume_pc_valid && pc == debug->resume_pc;
+	debug->resume_pc_valid = 0;
+
+	// Updated on every check, so that a condition that stays true doesn't break again after continue
+	uint8_t conditions_true = 0;
+	for(size_t n=0; n<debug->condition_count; n++) {
+		if(chip8_debug_check_condition(&debug->conditions[n], machine->cpu.v)) {
+			conditions_true |= 1U << n;
+		}
+	}
+	uint8_t conditions_turned_true = conditions_true & ~debug->conditions_true;
+	debug->conditions_true = conditions_true;
+
+	if(debug->single_step) {
+		if(debug->step_started) {
+			chip8_debug_break_before(machine, CHIP8_DEBUG_REASON_STEP, pc);
+			return 1;
+		}
+		debug->step_started = 1;
+	}
+	if(debug->step_over && pc == debug->step_over_pc && machine->cpu.pc_index == debug->step_over_pc_index) {
+		chip8_debug_break_before(machine, CHIP8_DEBUG_REASON_STEP, pc);
+		return 1;
+	}
+	if(!resumed && (debug->breakpoints[pc/32] & (1U << (pc%32)))) {
+		chip8_debug_break_before(machine, CHIP8_DEBUG_REASON_BREAKPOINT, pc);
+		return 1;
+	}
+	if(conditions_turned_true) {
+		chip8_debug_break_before(machine, CHIP8_DEBUG_REASON_CONDITION, pc);
+		return 1;
+	}
+	return 0;
+}
+
+// Breaks after the writing instruction has completed
+static void chip8_debug_check_write(struct chip8_machine *machine, uint16_t address, uint16_t size) {
+	for(uint16_t a=address; a<address+size; a++) {
+		if(machine->debug.watchpoints[a/32] & (1U << (a%32))) {
+			chip8_debug_break(machine, CHIP8_DEBUG_REASON_WATCHPOINT, a);
+			return;
+		}
+	}
+}
+#define CHIP8_DEBUG_CHECK_WRITE(address, size) chip8_debug_check_write(machine, address, size)
+#else
+#define CHIP8_DEBUG_CHECK_WRITE(address, size)
+#endif
+
+static void chip8_audio_publish(struct chip8_periph *periph) {
+	struct chip8_audio_latch *latch = &periph->audio_latch;
+	uint32_t version = atomic_load_explicit(&latch->version, memory_order_relaxed) + 1;
+	// Orders the previous publish's version store before the stores into the buffer it left unpublished. A reader
+	// that copies any of them then sees the version changed on its recheck, instead of accepting a torn copy.
+	atomic_thread_fence(memory_order_release);
+	for(size_t n=0; n<CHIP8_AUDIO_BUFFER_SIZE/4; n++) {
+		atomic_store_explicit(&latch->audio[version%2][n], periph->audio[n], memory_order_relaxed);
+	}
+	atomic_store_explicit(&latch->audio_pitch[version%2], periph->audio_pitch, memory_order_relaxed);
+	atomic_store_explicit(&latch->version, version, memory_order_release);
+}
+
 void chip8_step(struct chip8_machine *machine) {
 	#define CHIP8_HALT(condition, flag) \
 		if(condition) { \
@@ -62,6 +156,11 @@ void chip8_step(struct chip8_machine *machine) {
 		// The CPU has stopped. Do not allow it to execute further instructions
 		return;
 	}
+#ifdef CHIP8_DEBUGGER
+	if(chip8_debug_check_pc(machine)) {
+		return;
+	}
+#endif
 
 	uint16_t instruction = mem[cpu->pc[cpu->pc_index]] << 8;
 	instruction |= mem[cpu->pc[cpu->pc_index]+1];
@@ -70,6 +169,15 @@ void chip8_step(struct chip8_machine *machine) {
 	uint8_t *vf = &cpu->v[15];
 	uint16_t *i = &cpu->i;
 
+#ifdef CHIP8_TRACE
+	struct chip8_trace_record *trace = &machine->trace.records[machine->trace.count++ & (CHIP8_TRACE_SIZE-1)];
+	trace->pc = cpu->pc[cpu->pc_index];
+	trace->instruction = instruction;
+	trace->i = *i;
+	trace->vx = *vx;
+	trace->vf = *vf;
+#endif
+
 	switch(instruction & 0xF000) {
 		case 0x0000:
 			#define NEED_DOUBLE_SCROLL() (!periph->high_res && !(cpu->quirks & CHIP8_QUIRK_LORES_SCROLL_DIV2))
@@ -186,11 +294,13 @@ void chip8_step(struct chip8_machine *machine) {
 						for(size_t n=0; n<=y-x; n++) {
 							mem[*i+n] = cpu->v[x+n];
 						}
+						CHIP8_DEBUG_CHECK_WRITE(*i, y-x+1);
 					} else {
 						CHIP8_HALT(*i+(x-y) >= CHIP8_MEMORY_SIZE, CHIP8_REQUEST_HALT_I_ERROR);
 						for(size_t n=0; n<=x-y; n++) {
-							mem[*i+n] = cpu->v[y-n];
+							mem[*i+n] = cpu->v[x-n];
 						}
+						CHIP8_DEBUG_CHECK_WRITE(*i, x-y+1);
 					}
 				}
 				break;
@@ -204,7 +314,7 @@ void chip8_step(struct chip8_machine *machine) {
 					} else {
 						CHIP8_HALT(*i+(x-y) >= CHIP8_MEMORY_SIZE, CHIP8_REQUEST_HALT_I_ERROR);
 						for(size_t n=0; n<=x-y; n++) {
-							cpu->v[y-n] = mem[*i+n];
+							cpu->v[x-n] = mem[*i+n];
 						}
 					}
 				}
@@ -310,7 +420,11 @@ void chip8_step(struct chip8_machine *machine) {
 			prevents_stepping = 1;
 		break;
 		case 0xC000: // CXNN
-			*vx = periph->random_num & (instruction & 0x00FF);
+			// xorshift32. Only advanced here, so the sequence depends on nothing but the seed and the program
+			periph->random_state ^= periph->random_state << 13;
+			periph->random_state ^= periph->random_state >> 17;
+			periph->random_state ^= periph->random_state << 5;
+			*vx = (periph->random_state >> 24) & (instruction & 0x00FF);
 		break;
 		case 0xD000: // DXYN
 		{
@@ -337,7 +451,8 @@ void chip8_step(struct chip8_machine *machine) {
 			}
 
 			// Pass 2: Prepare sprite content in column-major format, leftmost is first column. For each column, topmost is LSB, bottommost is MSB
-			static uint32_t sprite_content[32]; // static for conserving stack storage space
+			// Not static: machines may be stepped on several threads at once (e.g. chip8-quirkscan). It's only 128 bytes.
+			uint32_t sprite_content[32];
 			memset(sprite_content, 0, sizeof(sprite_content));
 			switch(sprite_width) {
 				case 8: CHIP8_HALT(*i+(sprite_height-1) >= CHIP8_MEMORY_SIZE, CHIP8_REQUEST_HALT_I_ERROR); break;
@@ -489,6 +604,7 @@ void chip8_step(struct chip8_machine *machine) {
 											(mem[(*i) + n*4 + 2] << 8) |
 											(mem[(*i) + n*4 + 3] << 0);
 					}
+					chip8_audio_publish(periph);
 				break;
 				case 0x0007: // FX07
 					*vx = periph->delay_timer;
@@ -500,6 +616,7 @@ void chip8_step(struct chip8_machine *machine) {
 						for(size_t k=0; k<16; k++) {
 							if(periph->key_just_released & (1<<k)) {
 								*vx = k;
+								periph->key_just_released &= ~(1U<<k); // Consumed. Each release edge satisfies only one FX0A
 								break;
 							}
 						}
@@ -533,9 +650,11 @@ void chip8_step(struct chip8_machine *machine) {
 					mem[*i] = *vx / 100;
 					mem[*i+1] = (*vx - mem[*i] * 100) / 10;
 					mem[*i+2] = *vx - mem[*i]*100 - mem[*i+1]*10;
+					CHIP8_DEBUG_CHECK_WRITE(*i, 3);
 				break;
 				case 0x003A: // FX3A XO-Chip
 					periph->audio_pitch = *vx;
+					chip8_audio_publish(periph);
 				break;
 				case 0x0055: // FX55
 				{
@@ -544,6 +663,7 @@ void chip8_step(struct chip8_machine *machine) {
 					for(size_t x=0; x<=n; x++) {
 						mem[*i+x] = cpu->v[x];
 					}
+					CHIP8_DEBUG_CHECK_WRITE(*i, n+1);
 					if(cpu->quirks & CHIP8_QUIRK_MEMORY_LEAVE_I_UNCHANGED) {
 						// Do not increase I here: a.k.a. do nothing!
 					} else if (cpu->quirks & CHIP8_QUIRK_MEMORY_INCREASE_BY_X) {
@@ -588,6 +708,10 @@ void chip8_step(struct chip8_machine *machine) {
 			CHIP8_HALT(1, CHIP8_REQUEST_HALT_INVALID_INSTRUCTION);
 		break;
 	}
+#ifdef CHIP8_TRACE
+	trace->vx = *vx;
+	trace->vf = *vf;
+#endif
 	if(!prevents_stepping) {
 		cpu->pc[cpu->pc_index] += 2;
 	}
@@ -598,15 +722,168 @@ void chip8_step(struct chip8_machine *machine) {
 	CHIP8_HALT(cpu->pc[cpu->pc_index]+1 >= CHIP8_MEMORY_SIZE, CHIP8_REQUEST_HALT_PC_ERROR);
 }
 
-void chip8_timer_step(struct chip8_machine *machine) {
-	if(machine->periph.delay_timer > 0) {
-		machine->periph.delay_timer--;
+#if !defined(CHIP8_DEBUGGER) && !defined(CHIP8_TRACE)
+// Same PC check as the one at the end of chip8_step()
+static void chip8_fused_jump(struct chip8_machine *machine, uint16_t address) {
+	machine->cpu.pc[machine->cpu.pc_index] = address;
+	if(address+1 >= CHIP8_MEMORY_SIZE) {
+		chip8_halt_cpu(machine, CHIP8_REQUEST_HALT_PC_ERROR);
 	}
-	if(machine->periph.sound_timer > 0) {
-		machine->periph.sound_timer--;
+}
+
+// FX07;3XNN;1NNN and 7XNN;3XNN;1NNN. Returns the number of instructions run.
+static uint32_t chip8_fused_loop(struct chip8_machine *machine, uint16_t first, uint16_t skip, uint16_t jump, uint32_t budget) {
+	uint16_t pc = machine->cpu.pc[machine->cpu.pc_index];
+	uint8_t *vx = &machine->cpu.v[(first & 0x0F00)>>8];
+	uint32_t n = 0;
+	while(1) {
+		if((first & 0xF000) == 0xF000) {
+			*vx = machine->periph.delay_timer; // Read on every iteration, as the timer ISR may step it meanwhile
+		} else {
+			*vx += first & 0x00FF;
+		}
+		if(*vx == (skip & 0x00FF)) {
+			chip8_fused_jump(machine, pc+6); // 3XNN skips 1NNN
+			return n+2;
+		}
+		n += 3;
+		if((jump & 0x0FFF) != pc || budget-n < 3) {
+			chip8_fused_jump(machine, jump & 0x0FFF);
+			return n;
+		}
 	}
 }
 
+// Returns the number of instructions run, or 0 if there's no superinstruction at PC
+static uint32_t chip8_fuse(struct chip8_machine *machine, uint32_t budget) {
+	struct chip8_cpu *cpu = &machine->cpu;
+	const uint8_t *mem = machine->mem;
+	uint16_t pc = cpu->pc[cpu->pc_index];
+	if(cpu->halt || budget < 2 || pc+5 >= CHIP8_MEMORY_SIZE) {
+		return 0;
+	}
+	uint16_t op0 = (mem[pc] << 8) | mem[pc+1];
+	uint16_t op1 = (mem[pc+2] << 8) | mem[pc+3];
+	uint16_t op2 = (mem[pc+4] << 8) | mem[pc+5];
+	uint8_t x = (op0 & 0x0F00)>>8;
+	uint8_t pattern;
+	uint32_t n;
+	switch(op0 & 0xF000) {
+		case 0x6000:
+			// 6XNN;6YNN;DXYN
+			if(budget < 3 || (op1 & 0xF000) != 0x6000 || (op2 & 0xF000) != 0xD000 ||
+				((op2 & 0x0F00)>>8) != x || ((op2 & 0x00F0)>>4) != ((op1 & 0x0F00)>>8)) {
+				return 0;
+			}
+			cpu->v[x] = op0 & 0x00FF;
+			cpu->v[(op1 & 0x0F00)>>8] = op1 & 0x00FF;
+			cpu->pc[cpu->pc_index] = pc+4;
+			chip8_step(machine);
+			pattern = CHIP8_FUSION_SPRITE_SETUP;
+			n = 3;
+		break;
+		case 0xA000:
+			// ANNN;DXYN
+			if((op1 & 0xF000) != 0xD000) {
+				return 0;
+			}
+			cpu->i = op0 & 0x0FFF;
+			cpu->pc[cpu->pc_index] = pc+2;
+			chip8_step(machine);
+			pattern = CHIP8_FUSION_SPRITE_ADDRESS;
+			n = 2;
+		break;
+		case 0x7000:
+			// 7XNN;3XNN;1NNN
+			if(budget < 3 || (op1 & 0xFF00) != (0x3000 | (x << 8)) || (op2 & 0xF000) != 0x1000) {
+				return 0;
+			}
+			n = chip8_fused_loop(machine, op0, op1, op2, budget);
+			pattern = CHIP8_FUSION_COUNTER_LOOP;
+		break;
+		case 0xF000:
+			if((op0 & 0x00FF) == 0x0007) {
+				// FX07;3XNN;1NNN
+				if(budget < 3 || (op1 & 0xFF00) != (0x3000 | (x << 8)) || (op2 & 0xF000) != 0x1000) {
+					return 0;
+				}
+				n = chip8_fused_loop(machine, op0, op1, op2, budget);
+				pattern = CHIP8_FUSION_TIMER_POLL;
+			} else if((op0 & 0x00FF) == 0x001E && (op1 & 0xF0FF) == 0xF065) {
+				// FX1E;FX65
+				cpu->i += cpu->v[x];
+				cpu->pc[cpu->pc_index] = pc+2;
+				chip8_step(machine);
+				pattern = CHIP8_FUSION_TABLE_LOAD;
+				n = 2;
+			} else {
+				return 0;
+			}
+		break;
+		default:
+			return 0;
+	}
+	machine->fusion.fused[pattern]++;
+	machine->fusion.fused_instructions += n;
+	return n;
+}
+#endif
+
+uint32_t chip8_step_fused(struct chip8_machine *machine, uint32_t budget) {
+	uint32_t n = 0;
+#if !defined(CHIP8_DEBUGGER) && !defined(CHIP8_TRACE)
+	n = chip8_fuse(machine, budget);
+#endif
+	if(!n) {
+		chip8_step(machine);
+		n = 1;
+	}
+	machine->fusion.instructions += n;
+	return n;
+}
+
+void chip8_run_frame(struct chip8_machine *machine, uint32_t cycles) {
+	for(uint32_t n=0; n<cycles; ) {
+		if(machine->periph.requests & (CHIP8_REQUEST_WAIT_DISPLAY_REFRESH|CHIP8_REQUEST_DEBUG_BREAK|CHIP8_REQUEST_HALT_MASK)) {
+			break;
+		}
+		n += chip8_step_fused(machine, cycles-n);
+	}
+	if(machine->periph.requests & (CHIP8_REQUEST_DEBUG_BREAK|CHIP8_REQUEST_HALT_MASK)) {
+		// Time stands still while the debugger has the machine stopped
+		return;
+	}
+	machine->periph.requests &= ~CHIP8_REQUEST_WAIT_DISPLAY_REFRESH;
+	chip8_timer_step(machine);
+}
+
+// Decrements unless 0. FX15/FX18 may store into the timer in between, so it can't be a plain test then decrement.
+static void chip8_timer_decrement(_Atomic uint8_t *timer) {
+	uint8_t value = atomic_load_explicit(timer, memory_order_relaxed);
+	while(value > 0 && !atomic_compare_exchange_weak_explicit(timer, &value, value-1, memory_order_relaxed, memory_order_relaxed)) {
+	}
+}
+
+void chip8_timer_step(struct chip8_machine *machine) {
+	chip8_timer_decrement(&machine->periph.delay_timer);
+	chip8_timer_decrement(&machine->periph.sound_timer);
+}
+
+void chip8_audio_read(const struct chip8_periph *periph, uint32_t audio[CHIP8_AUDIO_BUFFER_SIZE/4], uint8_t *audio_pitch) {
+	const struct chip8_audio_latch *latch = &periph->audio_latch;
+	uint32_t version;
+	// Retries if chip8_step() published during the copy, as it may have started overwriting the buffer being copied.
+	// That can't happen when called from an ISR on the core that runs chip8_step().
+	do {
+		version = atomic_load_explicit(&latch->version, memory_order_acquire);
+		for(size_t n=0; n<CHIP8_AUDIO_BUFFER_SIZE/4; n++) {
+			audio[n] = atomic_load_explicit(&latch->audio[version%2][n], memory_order_relaxed);
+		}
+		*audio_pitch = atomic_load_explicit(&latch->audio_pitch[version%2], memory_order_relaxed);
+		atomic_thread_fence(memory_order_acquire);
+	} while(atomic_load_explicit(&latch->version, memory_order_relaxed) != version);
+}
+
 void chip8_init(struct chip8_machine *machine, const struct chip8_config *config) {
 	memset(&machine->periph.audio, 0xCC, sizeof(machine->periph.audio));
 
@@ -621,4 +898,85 @@ void chip8_init(struct chip8_machine *machine, const struct chip8_config *config
 	machine->periph.audio_pitch = 64; // 4000 Hz sampling rate by default as specified in XO-Chip's specs
 	memcpy(machine->periph.audio, config->audio, sizeof(config->audio));
 	memcpy(machine->periph.storage_flags, config->storage_flags, sizeof(config->storage_flags));
+	chip8_audio_publish(&machine->periph);
+	machine->periph.random_state = config->random_seed ? config->random_seed : 1; // xorshift gets stuck at 0
+
+	memset(&machine->fusion, 0, sizeof(machine->fusion));
+#ifdef CHIP8_DEBUGGER
+	memset(&machine->debug, 0, sizeof(machine->debug));
+#endif
+#ifdef CHIP8_TRACE
+	machine->trace.count = 0;
+#endif
+}
+
+#ifdef CHIP8_DEBUGGER
+void chip8_debug_set_breakpoint(struct chip8_machine *machine, uint16_t address, uint8_t enabled) {
+	if(address >= CHIP8_MEMORY_SIZE) {
+		return;
+	}
+	if(enabled) {
+		machine->debug.breakpoints[address/32] |= 1U << (address%32);
+	} else {
+		machine->debug.breakpoints[address/32] &= ~(1U << (address%32));
+	}
+}
+
+void chip8_debug_set_watchpoint(struct chip8_machine *machine, uint16_t address, uint16_t size, uint8_t enabled) {
+	for(uint32_t a=address; a<(uint32_t)address+size && a<CHIP8_MEMORY_SIZE; a++) {
+		if(enabled) {
+			machine->debug.watchpoints[a/32] |= 1U << (a%32);
+		} else {
+			machine->debug.watchpoints[a/32] &= ~(1U << (a%32));
+		}
+	}
+}
+
+int chip8_debug_add_condition(struct chip8_machine *machine, uint8_t reg, uint8_t op, uint8_t value) {
+	if(machine->debug.condition_count >= CHIP8_DEBUG_MAX_CONDITIONS || reg > 0xF) {
+		return -1;
+	}
+	struct chip8_debug_condition *condition = &machine->debug.conditions[machine->debug.condition_count++];
+	condition->reg = reg;
+	condition->op = op;
+	condition->value = value;
+	machine->debug.conditions_true &= ~(1U << (machine->debug.condition_count-1)); // Breaks if it's true already
+	return 0;
+}
+
+void chip8_debug_clear_conditions(struct chip8_machine *machine) {
+	machine->debug.condition_count = 0;
+	machine->debug.conditions_true = 0;
+}
+
+void chip8_debug_pause(struct chip8_machine *machine) {
+	if(machine->periph.requests & CHIP8_REQUEST_DEBUG_BREAK) {
+		return; // Keeps the reason of the break it's stopped at
+	}
+	chip8_debug_break(machine, CHIP8_DEBUG_REASON_PAUSE, machine->cpu.pc[machine->cpu.pc_index]);
+}
+
+void chip8_debug_continue(struct chip8_machine *machine) {
+	// The instruction that a breakpoint stopped at is run rather than stopped at again. See chip8_debug_break_before().
+	machine->periph.requests &= ~CHIP8_REQUEST_DEBUG_BREAK;
+}
+
+void chip8_debug_step(struct chip8_machine *machine) {
+	chip8_debug_continue(machine);
+	machine->debug.single_step = 1;
+	machine->debug.step_started = 0;
+}
+
+void chip8_debug_step_over(struct chip8_machine *machine) {
+	const struct chip8_cpu *cpu = &machine->cpu;
+	uint16_t pc = cpu->pc[cpu->pc_index];
+	if((machine->mem[pc] & 0xF0) != 0x20 || cpu->pc_index+1 >= CHIP8_PC_STACK_SIZE) {
+		chip8_debug_step(machine);
+		return;
+	}
+	chip8_debug_continue(machine);
+	machine->debug.step_over = 1;
+	machine->debug.step_over_pc = pc+2;
+	machine->debug.step_over_pc_index = cpu->pc_index;
 }
+#endif
@@ -26,6 +26,10 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#ifndef CHIP8_H
+#define CHIP8_H
+
+#include <stdatomic.h>
 #include <stdint.h>
 
 #define CHIP8_PROGRAM_START_OFFSET (0x200U)
@@ -61,6 +65,7 @@ struct chip8_cpu {
 };
 
 #define CHIP8_REQUEST_WAIT_DISPLAY_REFRESH (1U << 0)
+#define CHIP8_REQUEST_DEBUG_BREAK (1U << 1) // Stopped by the debugger. Only ever set with CHIP8_DEBUGGER defined.
 #define CHIP8_REQUEST_HALT_EXIT_EMULATOR (1U << 24) // Received instruction to exit the emulator
 #define CHIP8_REQUEST_HALT_I_ERROR (1U << 25) // I overread/overflow
 #define CHIP8_REQUEST_HALT_STACK_ERROR (1U << 26) // stack overflow/underflow
@@ -68,24 +73,125 @@ struct chip8_cpu {
 #define CHIP8_REQUEST_HALT_INVALID_INSTRUCTION (1U << 28) //Invalid instruction
 #define CHIP8_REQUEST_HALT_MASK (0xFF000000)
 
+// Audio pattern and pitch as published to the audio ISR. chip8_step() writes the unpublished buffer, then flips to it.
+// Ordering: the writer issues a release fence before writing the buffer and bumps version with release. The reader
+// loads version with acquire, copies the buffer and rechecks version after an acquire fence. A copy that includes
+// data from a later publish than the version loaded thus always sees the version changed on recheck, and retries.
+struct chip8_audio_latch {
+	_Atomic uint32_t audio[2][CHIP8_AUDIO_BUFFER_SIZE/4];
+	_Atomic uint8_t audio_pitch[2];
+	_Atomic uint32_t version; // Bumped on each publish. The published buffer is version%2.
+};
+
+// Concurrency: chip8_step() and chip8_run_frame() must not run concurrently with each other, but these may be
+// accessed from interrupts (or other threads) while they run:
+//   delay_timer, sound_timer: chip8_timer_step() from the 60Hz timer ISR
+//   key_held: stored by the keypad scan
+//   key_just_released: bits set by the keypad scan, e.g. with atomic_fetch_or()
+//   requests: bits set and cleared with atomic bit operations. |= and &= on these fields are atomic already.
+//   audio_latch: read by the audio ISR with chip8_audio_read()
+// Other fields, including audio and audio_pitch, are owned by chip8_step().
 struct chip8_periph {
-	uint8_t delay_timer;
-	uint8_t sound_timer;
-	uint16_t key_held;
-	uint16_t key_just_released;
+	_Atomic uint8_t delay_timer;
+	_Atomic uint8_t sound_timer;
+	_Atomic uint16_t key_held;
+	_Atomic uint16_t key_just_released; // Latched release edges. FX0A clears the bit it consumes, external code clears the rest on frame boundary.
 	uint8_t high_res;
-	uint8_t random_num;
 	uint8_t audio_pitch; // sample rate: 4000*(2**((audio_pitch-64)/48)) Hz
-	uint32_t requests;
+	_Atomic uint32_t requests;
+	uint32_t random_state; // State of the PRNG of CXNN. Can be overwritten for replay, but must not be 0.
 	uint32_t audio[CHIP8_AUDIO_BUFFER_SIZE/4]; // 32bit little-endian for better performance of ISR.
 	uint8_t display[CHIP8_DISPLAY_HEIGHT*CHIP8_DISPLAY_WIDTH/8]; // column-major, first column is leftmost. Each column is 64bit, the top bit is LSB.
 	uint8_t storage_flags[16];
+	struct chip8_audio_latch audio_latch;
+};
+
+#ifdef CHIP8_DEBUGGER
+// Debugger hooks. Without CHIP8_DEBUGGER defined, they're compiled out entirely.
+#define CHIP8_DEBUG_MAX_CONDITIONS (8U)
+
+#define CHIP8_DEBUG_REASON_PAUSE (1U)
+#define CHIP8_DEBUG_REASON_BREAKPOINT (2U)
+#define CHIP8_DEBUG_REASON_WATCHPOINT (3U)
+#define CHIP8_DEBUG_REASON_CONDITION (4U)
+#define CHIP8_DEBUG_REASON_STEP (5U)
+
+#define CHIP8_DEBUG_OP_EQUAL (0U)
+#define CHIP8_DEBUG_OP_NOT_EQUAL (1U)
+#define CHIP8_DEBUG_OP_LESS (2U)
+#define CHIP8_DEBUG_OP_GREATER (3U)
+
+struct chip8_debug_condition {
+	uint8_t reg;
+	uint8_t op;
+	uint8_t value;
+};
+
+struct chip8_debug {
+	uint32_t breakpoints[CHIP8_MEMORY_SIZE/32]; // Bit per address. Checked against PC before each instruction.
+	uint32_t watchpoints[CHIP8_MEMORY_SIZE/32]; // Bit per address. Checked against writes by FX55, FX33 and 5XY2.
+	struct chip8_debug_condition conditions[CHIP8_DEBUG_MAX_CONDITIONS]; // Breaks once any of them turns true
+	uint8_t condition_count;
+	uint8_t conditions_true; // Bit per condition, as of the last PC check. Conditions are edge-triggered.
+	uint8_t resume_pc_valid:1; // The last break was raised by the PC check of the instruction at resume_pc
+	uint16_t resume_pc; // Its breakpoint doesn't stop that instruction again on resuming
+	uint8_t single_step:1;
+	uint8_t step_started:1; // The instruction being stepped has passed its PC check
+	uint8_t step_over:1; // Breaks on reaching step_over_pc with the stack at step_over_pc_index
+	uint8_t step_over_pc_index:4;
+	uint16_t step_over_pc;
+	uint8_t reason; // CHIP8_DEBUG_REASON_* of the last break
+	uint16_t address; // Address that triggered the last breakpoint or watchpoint
 };
+#endif
 
+#ifdef CHIP8_TRACE
+// Instruction trace for post-mortem analysis. Without CHIP8_TRACE defined, it's compiled out entirely.
+#ifndef CHIP8_TRACE_SIZE
+#define CHIP8_TRACE_SIZE (4096U) // Must be a power of two
+#endif
+
+struct chip8_trace_record {
+	uint16_t pc;
+	uint16_t instruction;
+	uint16_t i; // Before the instruction
+	uint8_t vx; // After the instruction, unless it halted the machine. X is the one in the instruction.
+	uint8_t vf; // After the instruction, unless it halted the machine
+};
+
+struct chip8_trace {
+	struct chip8_trace_record records[CHIP8_TRACE_SIZE]; // Ring buffer. The latest record is at (count-1) % CHIP8_TRACE_SIZE.
+	uint32_t count; // Total number of records ever written
+};
+#endif
+
+// Superinstructions run by chip8_step_fused(). Each pattern is matched against the opcodes at PC right before it's run,
+// so a jump into the middle of a pattern or a rewritten pattern is simply run an instruction at a time.
+#define CHIP8_FUSION_SPRITE_SETUP (0U) // 6XNN;6YNN;DXYN
+#define CHIP8_FUSION_SPRITE_ADDRESS (1U) // ANNN;DXYN
+#define CHIP8_FUSION_TIMER_POLL (2U) // FX07;3XNN;1NNN. Spins in place while it jumps to itself.
+#define CHIP8_FUSION_COUNTER_LOOP (3U) // 7XNN;3XNN;1NNN. Spins in place while it jumps to itself.
+#define CHIP8_FUSION_TABLE_LOAD (4U) // FX1E;FX65
+#define CHIP8_FUSION_PATTERNS (5U)
+
+struct chip8_fusion_stats {
+	uint64_t instructions; // Run by chip8_step_fused()
+	uint64_t fused_instructions; // Out of them, the ones run as a part of a superinstruction
+	uint32_t fused[CHIP8_FUSION_PATTERNS]; // Number of superinstructions run, by CHIP8_FUSION_*
+};
+
+// Holds no pointers, so a struct assignment is a complete snapshot of the machine.
 struct chip8_machine {
 	struct chip8_cpu cpu; // contains CPU state that's read-only by the external code (not enforced!)
 	struct chip8_periph periph; // contains variables that can be both read and written by external code
 	uint8_t mem[CHIP8_MEMORY_SIZE]; // Upon run, external code load the program to chip8.mem[CHIP8_PROGRAM_START_OFFSET] with size of CHIP8_MEMORY_SIZE-CHIP8_PROGRAM_START_OFFSET.
+	struct chip8_fusion_stats fusion;
+#ifdef CHIP8_DEBUGGER
+	struct chip8_debug debug;
+#endif
+#ifdef CHIP8_TRACE
+	struct chip8_trace trace;
+#endif
 };
 
 struct chip8_config {
@@ -94,8 +200,31 @@ struct chip8_config {
 	uint32_t audio[CHIP8_AUDIO_BUFFER_SIZE/4];
 	uint8_t storage_flags[16];
 	uint32_t quirks;
+	uint32_t random_seed;
 };
 
 void chip8_step(struct chip8_machine *machine);
-void chip8_timer_step(struct chip8_machine *machine);
+// Runs a superinstruction of up to `budget` instructions if one is found at PC, otherwise a single instruction.
+// Returns the number of instructions run. The result is the same as that many chip8_step() calls.
+// The debugger and the trace need to see every instruction, so builds with either of them never fuse.
+uint32_t chip8_step_fused(struct chip8_machine *machine, uint32_t budget);
+void chip8_timer_step(struct chip8_machine *machine); // Safe to call from the timer ISR
+// Safe to call from the audio ISR. Copies the latest audio pattern and pitch published by chip8_step(), never a mix of two.
+void chip8_audio_read(const struct chip8_periph *periph, uint32_t audio[CHIP8_AUDIO_BUFFER_SIZE/4], uint8_t *audio_pitch);
+// Headless frame: runs up to `cycles` instructions, stopping early on VBLANK wait or halt, then steps the timers.
+// Key inputs are left to the caller.
+void chip8_run_frame(struct chip8_machine *machine, uint32_t cycles);
 void chip8_init(struct chip8_machine *machine, const struct chip8_config *config);
+
+#ifdef CHIP8_DEBUGGER
+void chip8_debug_set_breakpoint(struct chip8_machine *machine, uint16_t address, uint8_t enabled);
+void chip8_debug_set_watchpoint(struct chip8_machine *machine, uint16_t address, uint16_t size, uint8_t enabled);
+int chip8_debug_add_condition(struct chip8_machine *machine, uint8_t reg, uint8_t op, uint8_t value); // -1 if full
+void chip8_debug_clear_conditions(struct chip8_machine *machine);
+void chip8_debug_pause(struct chip8_machine *machine);
+void chip8_debug_continue(struct chip8_machine *machine);
+void chip8_debug_step(struct chip8_machine *machine);
+void chip8_debug_step_over(struct chip8_machine *machine); // Runs a 2NNN subroutine to its return. Same as step for other instructions.
+#endif
+
+#endif
@@ -0,0 +1,244 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "debugger.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const char *chip8_debugger_reason_names[] = {
+	[CHIP8_DEBUG_REASON_PAUSE] = "pause",
+	[CHIP8_DEBUG_REASON_BREAKPOINT] = "breakpoint",
+	[CHIP8_DEBUG_REASON_WATCHPOINT] = "watchpoint",
+	[CHIP8_DEBUG_REASON_CONDITION] = "condition",
+	[CHIP8_DEBUG_REASON_STEP] = "step",
+};
+
+static void chip8_debugger_send(struct chip8_debugger *debugger, const char *format, ...) {
+	char line[256];
+	va_list args;
+	va_start(args, format);
+	int size = vsnprintf(line, sizeof(line)-1, format, args);
+	va_end(args);
+	if(size < 0 || debugger->client_fd < 0) {
+		return;
+	}
+	if((size_t)size > sizeof(line)-2) {
+		size = sizeof(line)-2;
+	}
+	line[size++] = '\n';
+	if(send(debugger->client_fd, line, size, MSG_NOSIGNAL) != size) {
+		close(debugger->client_fd);
+		debugger->client_fd = -1;
+	}
+}
+
+static int chip8_debugger_parse_number(const char *token, unsigned long limit, unsigned long *value) {
+	char *end;
+	if(token == NULL) {
+		return -1;
+	}
+	*value = strtoul(token, &end, 0);
+	return (*end || *value > limit) ? -1 : 0;
+}
+
+static void chip8_debugger_print_registers(struct chip8_debugger *debugger, const struct chip8_machine *machine) {
+	const struct chip8_cpu *cpu = &machine->cpu;
+	chip8_debugger_send(debugger, "pc %04x pc_index %u i %04x", cpu->pc[cpu->pc_index], cpu->pc_index, cpu->i);
+	chip8_debugger_send(debugger, "v0..7 %02x %02x %02x %02x %02x %02x %02x %02x",
+		cpu->v[0], cpu->v[1], cpu->v[2], cpu->v[3], cpu->v[4], cpu->v[5], cpu->v[6], cpu->v[7]);
+	chip8_debugger_send(debugger, "v8..15 %02x %02x %02x %02x %02x %02x %02x %02x",
+		cpu->v[8], cpu->v[9], cpu->v[10], cpu->v[11], cpu->v[12], cpu->v[13], cpu->v[14], cpu->v[15]);
+	chip8_debugger_send(debugger, "delay %u sound %u requests %08x",
+		machine->periph.delay_timer, machine->periph.sound_timer, machine->periph.requests);
+}
+
+static void chip8_debugger_print_memory(struct chip8_debugger *debugger, const struct chip8_machine *machine, uint16_t address, uint16_t size) {
+	for(uint32_t row=address; row<(uint32_t)address+size; row+=16) {
+		char line[16*3+1];
+		size_t length = 0;
+		for(uint32_t a=row; a<row+16 && a<(uint32_t)address+size; a++) {
+			length += sprintf(&line[length], " %02x", machine->mem[a]);
+		}
+		chip8_debugger_send(debugger, "%04x%s", row, line);
+	}
+}
+
+// Returns the error message, NULL on success
+static const char *chip8_debugger_execute(struct chip8_debugger *debugger, struct chip8_machine *machine, char *line) {
+	char *command = strtok(line, " \t\r");
+	char *arg1 = strtok(NULL, " \t\r");
+	char *arg2 = strtok(NULL, " \t\r");
+	char *arg3 = strtok(NULL, " \t\r");
+	unsigned long address, size, value;
+	if(command == NULL) {
+		return "empty command";
+	}
+	if(!strcmp(command, "break") || !strcmp(command, "delete")) {
+		if(chip8_debugger_parse_number(arg1, CHIP8_MEMORY_SIZE-1, &address)) {
+			return "bad address";
+		}
+		chip8_debug_set_breakpoint(machine, address, command[0] == 'b');
+	} else if(!strcmp(command, "watch") || !strcmp(command, "unwatch")) {
+		size = 1;
+		if(chip8_debugger_parse_number(arg1, CHIP8_MEMORY_SIZE-1, &address) || (arg2 && chip8_debugger_parse_number(arg2, CHIP8_MEMORY_SIZE, &size))) {
+			return "bad address or size";
+		}
+		chip8_debug_set_watchpoint(machine, address, size, command[0] == 'w');
+	} else if(!strcmp(command, "cond")) {
+		static const char *ops[] = {
+			[CHIP8_DEBUG_OP_EQUAL] = "==",
+			[CHIP8_DEBUG_OP_NOT_EQUAL] = "!=",
+			[CHIP8_DEBUG_OP_LESS] = "<",
+			[CHIP8_DEBUG_OP_GREATER] = ">",
+		};
+		size_t op = 0;
+		while(op < sizeof(ops)/sizeof(ops[0]) && (arg2 == NULL || strcmp(arg2, ops[op]))) {
+			op++;
+		}
+		unsigned long reg;
+		if(chip8_debugger_parse_number(arg1, 0xF, &reg) || op >= sizeof(ops)/sizeof(ops[0]) || chip8_debugger_parse_number(arg3, 0xFF, &value)) {
+			return "usage: cond <reg> <==|!=|<|>> <value>";
+		}
+		if(chip8_debug_add_condition(machine, reg, op, value)) {
+			return "too many conditions";
+		}
+	} else if(!strcmp(command, "uncond")) {
+		chip8_debug_clear_conditions(machine);
+	} else if(!strcmp(command, "pause")) {
+		chip8_debug_pause(machine);
+	} else if(!strcmp(command, "continue")) {
+		chip8_debug_continue(machine);
+	} else if(!strcmp(command, "step")) {
+		chip8_debug_step(machine);
+	} else if(!strcmp(command, "next")) {
+		chip8_debug_step_over(machine);
+	} else if(!strcmp(command, "regs")) {
+		chip8_debugger_print_registers(debugger, machine);
+	} else if(!strcmp(command, "mem")) {
+		if(chip8_debugger_parse_number(arg1, CHIP8_MEMORY_SIZE-1, &address) || chip8_debugger_parse_number(arg2, CHIP8_MEMORY_SIZE, &size)) {
+			return "usage: mem <addr> <size>";
+		}
+		if(address+size > CHIP8_MEMORY_SIZE) {
+			size = CHIP8_MEMORY_SIZE-address;
+		}
+		chip8_debugger_print_memory(debugger, machine, address, size);
+	} else {
+		return "unknown command";
+	}
+	// Stepping clears the break. Let the UI know once the machine stops again.
+	debugger->stopped = !!(machine->periph.requests & CHIP8_REQUEST_DEBUG_BREAK) && debugger->stopped;
+	return NULL;
+}
+
+int chip8_debugger_open(struct chip8_debugger *debugger, const char *path) {
+	memset(debugger, 0, sizeof(*debugger));
+	debugger->client_fd = -1;
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if(strlen(path) >= sizeof(addr.sun_path)) {
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+	debugger->listen_fd = socket(AF_UNIX, SOCK_STREAM|SOCK_NONBLOCK, 0);
+	if(debugger->listen_fd < 0) {
+		return -1;
+	}
+	unlink(path);
+	if(bind(debugger->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) || listen(debugger->listen_fd, 1)) {
+		close(debugger->listen_fd);
+		return -1;
+	}
+	return 0;
+}
+
+void chip8_debugger_poll(struct chip8_debugger *debugger, struct chip8_machine *machine) {
+	if(debugger->client_fd < 0) {
+		debugger->client_fd = accept(debugger->listen_fd, NULL, NULL);
+		if(debugger->client_fd < 0) {
+			return;
+		}
+		debugger->in_size = 0;
+		debugger->stopped = 0;
+		debugger->halted = 0;
+	}
+
+	ssize_t received = recv(debugger->client_fd, &debugger->in[debugger->in_size], sizeof(debugger->in)-1-debugger->in_size, MSG_DONTWAIT);
+	if(received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+		// The UI has detached. Don't leave the machine stuck.
+		close(debugger->client_fd);
+		debugger->client_fd = -1;
+		chip8_debug_continue(machine);
+		return;
+	}
+	if(received > 0) {
+		debugger->in_size += received;
+		debugger->in[debugger->in_size] = '\0';
+		char *line = debugger->in;
+		char *newline;
+		while((newline = strchr(line, '\n')) != NULL) {
+			*newline = '\0';
+			const char *error = chip8_debugger_execute(debugger, machine, line);
+			if(error) {
+				chip8_debugger_send(debugger, "error %s", error);
+			} else {
+				chip8_debugger_send(debugger, "ok");
+			}
+			line = newline+1;
+		}
+		debugger->in_size -= line-debugger->in;
+		memmove(debugger->in, line, debugger->in_size);
+		if(debugger->in_size >= sizeof(debugger->in)-1) {
+			chip8_debugger_send(debugger, "error line too long");
+			debugger->in_size = 0;
+		}
+	}
+
+	if((machine->periph.requests & CHIP8_REQUEST_DEBUG_BREAK) && !debugger->stopped) {
+		debugger->stopped = 1;
+		chip8_debugger_send(debugger, "stopped %s %04x %04x", chip8_debugger_reason_names[machine->debug.reason],
+			machine->cpu.pc[machine->cpu.pc_index], machine->debug.address);
+	}
+	if((machine->periph.requests & CHIP8_REQUEST_HALT_MASK) && !debugger->halted) {
+		debugger->halted = 1;
+		chip8_debugger_send(debugger, "halted %08x", machine->periph.requests);
+	}
+}
+
+void chip8_debugger_close(struct chip8_debugger *debugger) {
+	if(debugger->client_fd >= 0) {
+		close(debugger->client_fd);
+	}
+	close(debugger->listen_fd);
+}
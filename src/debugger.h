@@ -0,0 +1,61 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CHIP8_DEBUGGER_H
+#define CHIP8_DEBUGGER_H
+
+// Debugger front end over a Unix domain socket, for a separate UI to attach to. Only built with CHIP8_DEBUGGER.
+//
+// The protocol is line-based text, so `socat - UNIX-CONNECT:<path>` makes a usable UI as well.
+// Numbers are accepted in C notation (0x200, 512). Commands:
+//   break <addr> / delete <addr>             set/clear a breakpoint
+//   watch <addr> [size] / unwatch <addr> [size]  set/clear write-watchpoints
+//   cond <reg> <==|!=|<|>> <value> / uncond    add a register condition, which breaks when it turns true / clear all
+//   pause / continue / step / next           next steps over 2NNN
+//   regs / mem <addr> <size>                 inspect the machine
+// Each command is answered with zero or more lines of output followed by "ok" or "error <message>".
+// Whenever the machine stops, "stopped <reason> <pc> <address>" is sent. When it halts, "halted <requests>".
+
+#include "chip8.h"
+#include <stddef.h>
+
+struct chip8_debugger {
+	int listen_fd;
+	int client_fd; // -1 if no UI is attached
+	char in[256];
+	size_t in_size;
+	uint8_t stopped; // Whether the attached UI has been told that the machine is stopped
+	uint8_t halted;
+};
+
+int chip8_debugger_open(struct chip8_debugger *debugger, const char *path); // -1 on error
+// Handles the commands from the attached UI and notifies it of breaks. Call it once per frame.
+void chip8_debugger_poll(struct chip8_debugger *debugger, struct chip8_machine *machine);
+void chip8_debugger_close(struct chip8_debugger *debugger);
+
+#endif
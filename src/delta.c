@@ -0,0 +1,89 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "delta.h"
+#include <string.h>
+
+static uint8_t chip8_delta_column_changed(const uint8_t *previous, const uint8_t *current, size_t x) {
+	return memcmp(&previous[x*CHIP8_DELTA_COLUMN_SIZE], &current[x*CHIP8_DELTA_COLUMN_SIZE], CHIP8_DELTA_COLUMN_SIZE) != 0;
+}
+
+size_t chip8_delta_encode(const uint8_t *previous, const uint8_t *current, uint8_t *out) {
+	size_t size = 0;
+	size_t x = 0;
+	while(1) {
+		size_t skip = 0;
+		while(x < CHIP8_DISPLAY_WIDTH && !chip8_delta_column_changed(previous, current, x)) {
+			x++;
+			skip++;
+		}
+		if(x >= CHIP8_DISPLAY_WIDTH) {
+			return size;
+		}
+		size_t count_index = size+1;
+		out[size++] = skip;
+		out[size++] = 0;
+		while(x < CHIP8_DISPLAY_WIDTH && chip8_delta_column_changed(previous, current, x)) {
+			for(size_t y=0; y<CHIP8_DELTA_COLUMN_SIZE; y++) {
+				out[size++] = previous[x*CHIP8_DELTA_COLUMN_SIZE+y] ^ current[x*CHIP8_DELTA_COLUMN_SIZE+y];
+			}
+			out[count_index]++;
+			x++;
+		}
+	}
+}
+
+int chip8_delta_apply(uint8_t *display, const uint8_t *delta, size_t size) {
+	size_t x = 0;
+	size_t n = 0;
+	while(n < size) {
+		if(n+2 > size) {
+			return -1;
+		}
+		x += delta[n];
+		size_t count = delta[n+1];
+		n += 2;
+		if(x+count > CHIP8_DISPLAY_WIDTH || n+count*CHIP8_DELTA_COLUMN_SIZE > size) {
+			return -1;
+		}
+		for(size_t c=0; c<count*CHIP8_DELTA_COLUMN_SIZE; c++) {
+			display[x*CHIP8_DELTA_COLUMN_SIZE+c] ^= delta[n+c];
+		}
+		x += count;
+		n += count*CHIP8_DELTA_COLUMN_SIZE;
+	}
+	return 0;
+}
+
+uint32_t chip8_display_checksum(const uint8_t *display) {
+	uint32_t hash = 2166136261U;
+	for(size_t n=0; n<CHIP8_DISPLAY_WIDTH*CHIP8_DISPLAY_HEIGHT/8; n++) {
+		hash = (hash ^ display[n]) * 16777619U;
+	}
+	return hash;
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CHIP8_DELTA_H
+#define CHIP8_DELTA_H
+
+#include "chip8.h"
+#include <stddef.h>
+
+// Delta encoding of the column-major display, for streaming and capturing the display.
+//
+// Each column is 64bit. The delta is the XOR of the current display against a previous one, run-length encoded
+// column by column as a sequence of runs:
+//   skip (1 byte): number of unchanged columns
+//   count (1 byte): number of changed columns that follow
+//   count*8 bytes: XOR of these changed columns, in the same byte order as the display
+// Runs are emitted until the last changed column, so an unchanged display encodes into zero bytes.
+
+#define CHIP8_DELTA_COLUMN_SIZE (CHIP8_DISPLAY_HEIGHT/8)
+#define CHIP8_DELTA_MAX_SIZE (CHIP8_DISPLAY_WIDTH*(CHIP8_DELTA_COLUMN_SIZE+2))
+
+// Returns the size of the delta written to out, which must have space for CHIP8_DELTA_MAX_SIZE bytes
+size_t chip8_delta_encode(const uint8_t *previous, const uint8_t *current, uint8_t *out);
+// Applies the delta onto display in-place. Returns 0 on success, -1 if the delta is malformed.
+int chip8_delta_apply(uint8_t *display, const uint8_t *delta, size_t size);
+// FNV-1a of the whole display, for checking the integrity of the displays reconstructed from deltas
+uint32_t chip8_display_checksum(const uint8_t *display);
+
+#endif
@@ -0,0 +1,120 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "disasm.h"
+#include <stdio.h>
+
+void chip8_disassemble(uint16_t instruction, char *out, size_t size) {
+	unsigned int x = (instruction & 0x0F00) >> 8;
+	unsigned int y = (instruction & 0x00F0) >> 4;
+	unsigned int n = instruction & 0x000F;
+	unsigned int nn = instruction & 0x00FF;
+	unsigned int nnn = instruction & 0x0FFF;
+	switch(instruction & 0xF000) {
+		case 0x0000:
+			if((instruction & 0xFFF0) == 0x00C0) {
+				snprintf(out, size, "SCD %u", n);
+				return;
+			}
+			if((instruction & 0xFFF0) == 0x00D0) {
+				snprintf(out, size, "SCU %u", n);
+				return;
+			}
+			switch(instruction) {
+				case 0x00E0: snprintf(out, size, "CLS"); return;
+				case 0x00EE: snprintf(out, size, "RET"); return;
+				case 0x00FB: snprintf(out, size, "SCR"); return;
+				case 0x00FC: snprintf(out, size, "SCL"); return;
+				case 0x00FD: snprintf(out, size, "EXIT"); return;
+				case 0x00FE: snprintf(out, size, "LOW"); return;
+				case 0x00FF: snprintf(out, size, "HIGH"); return;
+			}
+		break;
+		case 0x1000: snprintf(out, size, "JP 0x%03x", nnn); return;
+		case 0x2000: snprintf(out, size, "CALL 0x%03x", nnn); return;
+		case 0x3000: snprintf(out, size, "SE V%X, 0x%02x", x, nn); return;
+		case 0x4000: snprintf(out, size, "SNE V%X, 0x%02x", x, nn); return;
+		case 0x5000:
+			switch(n) {
+				case 0x0: snprintf(out, size, "SE V%X, V%X", x, y); return;
+				case 0x2: snprintf(out, size, "SAVE V%X-V%X", x, y); return;
+				case 0x3: snprintf(out, size, "LOAD V%X-V%X", x, y); return;
+			}
+		break;
+		case 0x6000: snprintf(out, size, "LD V%X, 0x%02x", x, nn); return;
+		case 0x7000: snprintf(out, size, "ADD V%X, 0x%02x", x, nn); return;
+		case 0x8000:
+			switch(n) {
+				case 0x0: snprintf(out, size, "LD V%X, V%X", x, y); return;
+				case 0x1: snprintf(out, size, "OR V%X, V%X", x, y); return;
+				case 0x2: snprintf(out, size, "AND V%X, V%X", x, y); return;
+				case 0x3: snprintf(out, size, "XOR V%X, V%X", x, y); return;
+				case 0x4: snprintf(out, size, "ADD V%X, V%X", x, y); return;
+				case 0x5: snprintf(out, size, "SUB V%X, V%X", x, y); return;
+				case 0x6: snprintf(out, size, "SHR V%X, V%X", x, y); return;
+				case 0x7: snprintf(out, size, "SUBN V%X, V%X", x, y); return;
+				case 0xE: snprintf(out, size, "SHL V%X, V%X", x, y); return;
+			}
+		break;
+		case 0x9000:
+			if(n == 0) {
+				snprintf(out, size, "SNE V%X, V%X", x, y);
+				return;
+			}
+		break;
+		case 0xA000: snprintf(out, size, "LD I, 0x%03x", nnn); return;
+		case 0xB000: snprintf(out, size, "JP V0, 0x%03x", nnn); return;
+		case 0xC000: snprintf(out, size, "RND V%X, 0x%02x", x, nn); return;
+		case 0xD000: snprintf(out, size, "DRW V%X, V%X, %u", x, y, n); return;
+		case 0xE000:
+			switch(nn) {
+				case 0x9E: snprintf(out, size, "SKP V%X", x); return;
+				case 0xA1: snprintf(out, size, "SKNP V%X", x); return;
+			}
+		break;
+		case 0xF000:
+			switch(nn) {
+				case 0x02: snprintf(out, size, "AUDIO"); return;
+				case 0x07: snprintf(out, size, "LD V%X, DT", x); return;
+				case 0x0A: snprintf(out, size, "LD V%X, K", x); return;
+				case 0x15: snprintf(out, size, "LD DT, V%X", x); return;
+				case 0x18: snprintf(out, size, "LD ST, V%X", x); return;
+				case 0x1E: snprintf(out, size, "ADD I, V%X", x); return;
+				case 0x29: snprintf(out, size, "LD F, V%X", x); return;
+				case 0x30: snprintf(out, size, "LD HF, V%X", x); return;
+				case 0x33: snprintf(out, size, "LD B, V%X", x); return;
+				case 0x3A: snprintf(out, size, "PITCH V%X", x); return;
+				case 0x55: snprintf(out, size, "LD [I], V%X", x); return;
+				case 0x65: snprintf(out, size, "LD V%X, [I]", x); return;
+				case 0x75: snprintf(out, size, "LD R, V%X", x); return;
+				case 0x85: snprintf(out, size, "LD V%X, R", x); return;
+			}
+		break;
+	}
+	snprintf(out, size, "DW 0x%04x", instruction);
+}
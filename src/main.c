@@ -14,86 +14,600 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
-#include "chip8.h"
+#include "config.h"
+#include "capture.h"
+#include "quirkdb.h"
+#include "rollback.h"
+#ifdef CHIP8_DEBUGGER
+#include "debugger.h"
+#endif
+#ifdef CHIP8_TRACE
+#include "trace.h"
+#endif
 #include <SDL2/SDL.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <unistd.h>
 
 struct chip8_machine chip8;
 #define BORDER_WIDTH (20U)
 #define PIXEL_SCALE (4U)
-#define FRAME_DURATION_MS (1000/60) // 60Hz for display refresh
-#define CYCLE_PER_FRAME (20)
-
-#define CHIP8_QUIRK_PLATFORM_VIP (CHIP8_QUIRK_VBLANK|CHIP8_QUIRK_LOGIC)
-#define CHIP8_QUIRK_PLATFORM_SCHIP (CHIP8_QUIRK_SHIFT|CHIP8_QUIRK_MEMORY_LEAVE_I_UNCHANGED|CHIP8_QUIRK_JUMP|CHIP8_QUIRK_HIRES_COLLISION)
-#define CHIP8_QUIRK_PLATFORM_XOCHIP (CHIP8_QUIRK_WRAP|CHIP8_QUIRK_LORES_WIDE_SPRITE|CHIP8_QUIRK_RESIZE_CLEAR_SCREEN)
-
-const struct chip8_config chip8_cfg = {
-	.font = {
-		0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-		0x20, 0x60, 0x20, 0x20, 0x70, // 1
-		0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-		0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-		0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-		0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-		0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-		0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-		0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-		0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-		0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-		0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-		0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-		0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-		0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-		0xF0, 0x80, 0xF0, 0x80, 0x80, // F
-	},
-	.font_highres = {
-		0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
-		0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
-		0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
-		0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
-		0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
-		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
-		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
-		0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
-		0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
-		0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
-		0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
-		0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
-		0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
-		0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
-		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
-		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
-	},
-	// 1000Hz squarewave, pulse width: 4 samples, 50% duty cycle
-	.audio = {0xCCCCCCCC, 0xCCCCCCCC, 0xCCCCCCCC, 0xCCCCCCCC},
-	.storage_flags = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-	.quirks = CHIP8_QUIRK_PLATFORM_VIP
+
+// Index is the CHIP-8 key, value is the scancode of the host keyboard
+static const SDL_Scancode keymap[16] = {
+	SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3,
+	SDL_SCANCODE_Q, SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_A,
+	SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C,
+	SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V,
 };
 
+// Written by key_event_watch(), which runs on whichever thread pushes the event. Read by the emulation loop.
+static SDL_atomic_t key_held_atomic;
+static SDL_atomic_t key_released_atomic; // Release edges latched until the next frame boundary
+static SDL_atomic_t key_event_tick; // SDL_GetTicks() of the oldest key event whose effect hasn't been presented yet. 0 if none. Replaced once timed out.
+
+#define INPUT_LATENCY_TIMEOUT_MS (500U) // A key that changes nothing on the screen within this period isn't counted
+static struct {
+	uint32_t samples;
+	uint32_t total_ms;
+	uint32_t max_ms;
+} input_latency;
+
+#define GOVERNOR_FRAME_RATE (60U)
+#define GOVERNOR_MAX_FRAME_SKIP (3U) // Renders at least every 4th frame
+#define GOVERNOR_MAX_LATE_FRAMES (6U) // Further behind than this, the schedule is restarted instead of caught up with
+#define GOVERNOR_ADJUST_INTERVAL (30U) // Frames between adjustments
+#define GOVERNOR_HIGH_LOAD (90U) // Percentage of the frame period spent emulating and rendering
+#define GOVERNOR_LOW_LOAD (60U)
+#define GOVERNOR_SPIN_MS (2U) // The last bit of waiting is spun, as SDL_Delay() may oversleep
+
+static uint8_t process_events(void);
+
+// Paces the frames at exactly GOVERNOR_FRAME_RATE with the high resolution counter. Each deadline is computed from the
+// start of the schedule, so the rounding of the frame period never accumulates into drift. When the host can't keep
+// up, it renders fewer frames first, and only then runs fewer instructions per frame.
+static struct {
+	uint64_t frequency; // Of SDL_GetPerformanceCounter()
+	uint64_t start; // Counter at frame 0 of the schedule
+	uint64_t frame; // Frames since start
+	uint32_t target_cycles; // Instructions per frame. -i, else the quirk database, else CYCLE_PER_FRAME.
+	uint32_t cycles; // Instructions per frame run. Lowered below target_cycles only while rendering every 4th frame.
+	uint8_t fixed_cycles; // The rollback link needs the same number of instructions per frame on both sides
+	uint32_t frame_skip; // Frames not rendered after each rendered one
+	uint64_t emulation_ticks; // Moving averages of the time spent per frame
+	uint64_t render_ticks;
+	// Stats
+	uint32_t frames;
+	uint32_t rendered_frames;
+	uint32_t slowed_frames; // Run with fewer instructions than target_cycles
+	uint32_t late_frames; // Started over 1ms past their deadline
+	uint32_t resyncs;
+	uint64_t total_jitter_us;
+	uint32_t max_jitter_us;
+} governor;
+
+static void governor_start(void) {
+	governor.frequency = SDL_GetPerformanceFrequency();
+	governor.start = SDL_GetPerformanceCounter();
+	governor.frame = 1; // The first frame is run right away, the first deadline is a frame period later
+}
+
+static uint64_t governor_deadline(void) {
+	return governor.start + governor.frame*governor.frequency/GOVERNOR_FRAME_RATE;
+}
+
+static void governor_average(uint64_t *average, uint64_t sample) {
+	*average = (*average*7 + sample)/8;
+}
+
+// Idles until the deadline of the current frame, delivering events meanwhile. Returns 0 if the window is closed.
+static uint8_t governor_wait(void) {
+	uint64_t deadline = governor_deadline();
+	uint64_t now;
+	while((now = SDL_GetPerformanceCounter()) < deadline) {
+		// Idle time is spent on delivering events, so that the key event watch timestamps them promptly
+		if(!process_events()) {
+			return 0;
+		}
+		if(deadline-now > governor.frequency*GOVERNOR_SPIN_MS/1000) {
+			SDL_Delay(1);
+		}
+	}
+
+	uint64_t late = now-deadline;
+	if(late > governor.frequency*GOVERNOR_MAX_LATE_FRAMES/GOVERNOR_FRAME_RATE) {
+		// The host has stalled (e.g. suspended). Running the missed frames back to back would only fast-forward the game.
+		governor.start = now - governor.frame*governor.frequency/GOVERNOR_FRAME_RATE;
+		governor.resyncs++;
+	}
+	uint32_t jitter_us = late*1000000/governor.frequency;
+	governor.total_jitter_us += jitter_us;
+	if(jitter_us > governor.max_jitter_us) {
+		governor.max_jitter_us = jitter_us;
+	}
+	if(jitter_us > 1000) {
+		governor.late_frames++;
+	}
+	return 1;
+}
+
+static uint8_t governor_should_render(void) {
+	if(governor.frame % (governor.frame_skip+1)) {
+		return 0;
+	}
+	governor.rendered_frames++;
+	return 1;
+}
+
+// Percentage of the frame period spent on average, if every (frame_skip+1)th frame is rendered
+static uint64_t governor_load(uint32_t frame_skip) {
+	uint64_t ticks = governor.emulation_ticks + governor.render_ticks/(frame_skip+1);
+	return ticks*100*GOVERNOR_FRAME_RATE/governor.frequency;
+}
+
+static void governor_end_frame(void) {
+	governor.frames++;
+	if(governor.cycles < governor.target_cycles) {
+		governor.slowed_frames++;
+	}
+	governor.frame++;
+	if(governor.frame % GOVERNOR_ADJUST_INTERVAL) {
+		return;
+	}
+	uint64_t load = governor_load(governor.frame_skip);
+	if(load > GOVERNOR_HIGH_LOAD) {
+		if(governor.frame_skip < GOVERNOR_MAX_FRAME_SKIP) {
+			governor.frame_skip++;
+		} else if(!governor.fixed_cycles && governor.cycles > 1) {
+			governor.cycles -= (governor.cycles+7)/8;
+		}
+	} else if(load < GOVERNOR_LOW_LOAD) {
+		if(governor.cycles < governor.target_cycles) {
+			governor.cycles += (governor.cycles+7)/8;
+			if(governor.cycles > governor.target_cycles) {
+				governor.cycles = governor.target_cycles;
+			}
+		} else if(governor.frame_skip && governor_load(governor.frame_skip-1) < (GOVERNOR_LOW_LOAD+GOVERNOR_HIGH_LOAD)/2) {
+			governor.frame_skip--;
+		}
+	}
+}
+
+#define RUN_AHEAD_MAX_FRAMES (2U)
+// Run-ahead: each presented frame is taken from a copy of the machine emulated this many frames further with the latest keys.
+// The copy is thrown away afterwards, so the game reacts to a key press on screen up to this many frames earlier.
+static struct {
+	uint32_t frames_ahead;
+	struct chip8_machine machine;
+	uint32_t samples;
+	uint64_t total_us;
+	uint32_t max_us;
+} run_ahead;
+
+// Two-player link. The machine is then run a frame at a time by the rollback link instead of an instruction at a time.
+static struct chip8_rollback rollback;
+static uint8_t linked;
+
+#define CAPTURE_QUEUE_SIZE (64U) // About a second of frames
+
+// Single-producer single-consumer queue from the emulation loop to the capture writer thread.
+// The emulation loop never waits for the writer. If the queue is full, the frame is dropped.
+static struct {
+	struct chip8_capture_frame frames[CAPTURE_QUEUE_SIZE];
+	SDL_atomic_t head; // Written by the emulation loop only
+	SDL_atomic_t tail; // Written by the writer thread only
+	SDL_atomic_t stop;
+	SDL_sem *ready;
+	SDL_Thread *thread;
+	struct chip8_capture_writer writer;
+	uint32_t frames_captured;
+	uint32_t frames_dropped;
+	uint8_t write_error; // Only read after the writer thread has exited
+} capture;
+
+#ifdef CHIP8_DEBUGGER
+static struct chip8_debugger debugger;
+#define DEBUGGER_OPTIONS "d:"
+#else
+#define DEBUGGER_OPTIONS ""
+#endif
+#ifdef CHIP8_TRACE
+#define TRACE_OPTIONS "t:"
+#else
+#define TRACE_OPTIONS ""
+#endif
+
+static void atomic_update_bits(SDL_atomic_t *a, int set, int clear) {
+	int old;
+	do {
+		old = SDL_AtomicGet(a);
+	} while(!SDL_AtomicCAS(a, old, (old | set) & ~clear));
+}
+
+static int key_event_watch(void *userdata, SDL_Event *event) {
+	(void)userdata;
+	if((event->type != SDL_KEYDOWN && event->type != SDL_KEYUP) || event->key.repeat) {
+		return 0;
+	}
+	for(size_t k=0; k<16; k++) {
+		if(event->key.keysym.scancode == keymap[k]) {
+			if(event->type == SDL_KEYDOWN) {
+				atomic_update_bits(&key_held_atomic, 1U << k, 0);
+			} else {
+				atomic_update_bits(&key_held_atomic, 0, 1U << k);
+				atomic_update_bits(&key_released_atomic, 1U << k, 0);
+			}
+			// A pending key event that hasn't changed the screen in time is replaced, rather than blocking later ones
+			// until an unrelated redraw gets credited with its latency.
+			uint32_t tick = SDL_GetTicks();
+			int old;
+			do {
+				old = SDL_AtomicGet(&key_event_tick);
+				if(old && tick - (uint32_t)old <= INPUT_LATENCY_TIMEOUT_MS) {
+					break;
+				}
+			} while(!SDL_AtomicCAS(&key_event_tick, old, tick ? tick : 1));
+			break;
+		}
+	}
+	return 0;
+}
+
+// Drains the event queue. Key events are handled by key_event_watch() as they're pushed.
+// Returns 0 if the emulator should quit.
+static uint8_t process_events(void) {
+	SDL_Event event;
+	while (SDL_PollEvent(&event)) {
+		switch(event.type) {
+			case SDL_QUIT:
+				return 0;
+			break;
+		}
+	}
+	return 1;
+}
+
+static void record_input_latency(uint32_t latency_ms) {
+	if(latency_ms > INPUT_LATENCY_TIMEOUT_MS) {
+		return;
+	}
+	input_latency.samples++;
+	input_latency.total_ms += latency_ms;
+	if(latency_ms > input_latency.max_ms) {
+		input_latency.max_ms = latency_ms;
+	}
+}
+
+static int capture_thread(void *userdata) {
+	(void)userdata;
+	while(1) {
+		unsigned int tail = SDL_AtomicGet(&capture.tail);
+		if(tail == (unsigned int)SDL_AtomicGet(&capture.head)) {
+			if(SDL_AtomicGet(&capture.stop)) {
+				break;
+			}
+			SDL_SemWaitTimeout(capture.ready, 100);
+			continue;
+		}
+		SDL_MemoryBarrierAcquire();
+		if(chip8_capture_writer_write(&capture.writer, &capture.frames[tail % CAPTURE_QUEUE_SIZE])) {
+			capture.write_error = 1;
+		}
+		SDL_MemoryBarrierRelease();
+		SDL_AtomicSet(&capture.tail, tail+1);
+	}
+	return 0;
+}
+
+static int capture_start(const char *path) {
+	if(chip8_capture_writer_open(&capture.writer, path)) {
+		return -1;
+	}
+	capture.ready = SDL_CreateSemaphore(0);
+	if(capture.ready) {
+		capture.thread = SDL_CreateThread(capture_thread, "capture", NULL);
+	}
+	if(capture.thread == NULL) {
+		if(capture.ready) {
+			SDL_DestroySemaphore(capture.ready);
+		}
+		// Nothing has been captured into it
+		chip8_capture_writer_close(&capture.writer);
+		remove(path);
+		return -1;
+	}
+	return 0;
+}
+
+static void capture_push(const struct chip8_machine *machine) {
+	unsigned int head = SDL_AtomicGet(&capture.head);
+	if(head - (unsigned int)SDL_AtomicGet(&capture.tail) >= CAPTURE_QUEUE_SIZE) {
+		capture.frames_dropped++;
+		return;
+	}
+	SDL_MemoryBarrierAcquire();
+	struct chip8_capture_frame *frame = &capture.frames[head % CAPTURE_QUEUE_SIZE];
+	memcpy(frame->display, machine->periph.display, sizeof(frame->display));
+	memcpy(frame->audio, machine->periph.audio, sizeof(frame->audio));
+	frame->audio_pitch = machine->periph.audio_pitch;
+	frame->high_res = machine->periph.high_res;
+	frame->sound = machine->periph.sound_timer > 0;
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&capture.head, head+1);
+	SDL_SemPost(capture.ready);
+	capture.frames_captured++;
+}
+
+static void capture_stop(void) {
+	SDL_AtomicSet(&capture.stop, 1);
+	SDL_SemPost(capture.ready);
+	SDL_WaitThread(capture.thread, NULL);
+	capture.thread = NULL;
+	if(chip8_capture_writer_close(&capture.writer) || capture.write_error) {
+		fprintf(stderr, "Failed to write the capture file\n");
+	}
+	SDL_DestroySemaphore(capture.ready);
+}
+
+// Returns the machine to be presented
+static const struct chip8_machine *run_ahead_frames(void) {
+	if(!run_ahead.frames_ahead || (chip8.periph.requests & (CHIP8_REQUEST_DEBUG_BREAK|CHIP8_REQUEST_HALT_MASK))) {
+		return &chip8;
+	}
+	uint64_t start = SDL_GetPerformanceCounter();
+	run_ahead.machine = chip8;
+#ifdef CHIP8_DEBUGGER
+	// Breakpoints and watchpoints must not stop a speculative frame, nor step its state
+	memset(&run_ahead.machine.debug, 0, sizeof(run_ahead.machine.debug));
+#endif
+	// Same as what the frame boundary does to the real machine, but with the keys pressed up to now
+	run_ahead.machine.periph.requests &= ~CHIP8_REQUEST_WAIT_DISPLAY_REFRESH;
+	chip8_timer_step(&run_ahead.machine);
+	run_ahead.machine.periph.key_held = SDL_AtomicGet(&key_held_atomic);
+	run_ahead.machine.periph.key_just_released = SDL_AtomicGet(&key_released_atomic);
+	for(uint32_t n=0; n<run_ahead.frames_ahead; n++) {
+		chip8_run_frame(&run_ahead.machine, governor.cycles);
+		run_ahead.machine.periph.key_just_released = 0;
+	}
+	uint32_t us = (SDL_GetPerformanceCounter()-start)*1000000/SDL_GetPerformanceFrequency();
+	run_ahead.samples++;
+	run_ahead.total_us += us;
+	if(us > run_ahead.max_us) {
+		run_ahead.max_us = us;
+	}
+	return &run_ahead.machine;
+}
+
+static void print_stats(void) {
+	printf("Stats:\n");
+	if(input_latency.samples) {
+		printf("key-to-effect latency:\tavg %u ms, max %u ms, %u samples\n",
+			input_latency.total_ms/input_latency.samples, input_latency.max_ms, input_latency.samples);
+	} else {
+		printf("key-to-effect latency:\tno samples\n");
+	}
+	if(capture.thread) {
+		printf("capture:\t%u frames, %u dropped\n", capture.frames_captured, capture.frames_dropped);
+	}
+	if(linked) {
+		printf("link:\t%u rollbacks, %u frames re-simulated, max %u at once, %u stalls\n",
+			rollback.rollbacks, rollback.frames_resimulated, rollback.max_rollback_frames, rollback.stalls);
+	}
+	if(governor.frames) {
+		printf("timing:\t%u frames, %u rendered, jitter avg %u us, max %u us, %u frames late by over 1 ms, %u resyncs\n",
+			governor.frames, governor.rendered_frames, (uint32_t)(governor.total_jitter_us/governor.frames), governor.max_jitter_us,
+			governor.late_frames, governor.resyncs);
+		printf("speed:\t%u instructions per frame targeted, %u at the end, %u frames slowed down\n",
+			governor.target_cycles, governor.cycles, governor.slowed_frames);
+	}
+	if(chip8.fusion.instructions) {
+		printf("fusion:\t%llu of %llu instructions fused (%u sprite setups, %u sprite addresses, %u timer polls, %u counter loops, %u table loads)\n",
+			(unsigned long long)chip8.fusion.fused_instructions, (unsigned long long)chip8.fusion.instructions,
+			chip8.fusion.fused[CHIP8_FUSION_SPRITE_SETUP], chip8.fusion.fused[CHIP8_FUSION_SPRITE_ADDRESS],
+			chip8.fusion.fused[CHIP8_FUSION_TIMER_POLL], chip8.fusion.fused[CHIP8_FUSION_COUNTER_LOOP],
+			chip8.fusion.fused[CHIP8_FUSION_TABLE_LOAD]);
+	}
+	if(run_ahead.samples) {
+		printf("run-ahead:\t%u frames, avg %u us, max %u us per presented frame, avg %u us per frame run ahead\n", run_ahead.frames_ahead,
+			(uint32_t)(run_ahead.total_us/run_ahead.samples), run_ahead.max_us,
+			(uint32_t)(run_ahead.total_us/run_ahead.samples/run_ahead.frames_ahead));
+	}
+}
+
+static void print_halt_state(void) {
+	printf("Machine halted! Reason(s):\n");
+	if(chip8.periph.requests & CHIP8_REQUEST_HALT_EXIT_EMULATOR) {
+		printf("CHIP8_REQUEST_HALT_EXIT_EMULATOR ");
+	}
+	if(chip8.periph.requests & CHIP8_REQUEST_HALT_I_ERROR) {
+		printf("CHIP8_REQUEST_HALT_I_ERROR ");
+	}
+	if(chip8.periph.requests & CHIP8_REQUEST_HALT_STACK_ERROR) {
+		printf("CHIP8_REQUEST_HALT_STACK_ERROR ");
+	}
+	if(chip8.periph.requests & CHIP8_REQUEST_HALT_PC_ERROR) {
+		printf("CHIP8_REQUEST_HALT_PC_ERROR ");
+	}
+	if(chip8.periph.requests & CHIP8_REQUEST_HALT_INVALID_INSTRUCTION) {
+		printf("CHIP8_REQUEST_HALT_INVALID_INSTRUCTION ");
+	}
+	printf("\n");
+	printf("PC0..4:\t%04x %04x %04x %04x\n", chip8.cpu.pc[0], chip8.cpu.pc[1], chip8.cpu.pc[2], chip8.cpu.pc[3]);
+	printf("PC5..8:\t%04x %04x %04x %04x\n", chip8.cpu.pc[4], chip8.cpu.pc[5], chip8.cpu.pc[6], chip8.cpu.pc[7]);
+	printf("PC9..12:\t%04x %04x %04x %04x\n", chip8.cpu.pc[8], chip8.cpu.pc[9], chip8.cpu.pc[10], chip8.cpu.pc[11]);
+	printf("PC13..16:\t%04x %04x %04x %04x\n", chip8.cpu.pc[12], chip8.cpu.pc[13], chip8.cpu.pc[14], chip8.cpu.pc[15]);
+	printf("pc_index:\t%u\n", chip8.cpu.pc_index);
+	printf("v0..7:\t%02x %02x %02x %02x %02x %02x %02x %02x\n",
+		chip8.cpu.v[0], chip8.cpu.v[1], chip8.cpu.v[2], chip8.cpu.v[3], chip8.cpu.v[4], chip8.cpu.v[5], chip8.cpu.v[6], chip8.cpu.v[7]);
+	printf("v8..15:\t%02x %02x %02x %02x %02x %02x %02x %02x\n",
+		chip8.cpu.v[8], chip8.cpu.v[9], chip8.cpu.v[10], chip8.cpu.v[11], chip8.cpu.v[12], chip8.cpu.v[13], chip8.cpu.v[14], chip8.cpu.v[15]);
+	printf("i:\t%04x\n", chip8.cpu.i);
+}
+
+static void print_usage(const char *program) {
+	fprintf(stderr, "Usage: %s [options] <chip8rom.ch8>\n", program);
+	fprintf(stderr, "\t-s seed\tSeed of the random number generator. Same seed, same inputs, same run.\n");
+	fprintf(stderr, "\t-c file\tCapture the gameplay to the file. Render it with chip8-capture-render.\n");
+	fprintf(stderr, "\t-i cycles\tInstructions per frame. Default: from the quirk database, else %u\n", CYCLE_PER_FRAME);
+	fprintf(stderr, "\t-r frames\tRun ahead by up to %u frames to hide the game's own input lag. Default: 0\n", RUN_AHEAD_MAX_FRAMES);
+	fprintf(stderr, "\t-l socket\tLink with another emulator over the Unix domain socket to play with two players. Both need the same ROM, quirks and seed.\n");
+	fprintf(stderr, "\t-p player\tPlayer on the link: 1 (keys 0-7) listens on the socket, 2 (keys 8-F) connects to it. Default: 1\n");
+	fprintf(stderr, "\t-L frames\tDelay the keys sent over the link by up to %u frames, for testing\n", CHIP8_ROLLBACK_WINDOW/2);
+	fprintf(stderr, "\t-q quirks\tCHIP8_QUIRK_* mask in hex. Default: from the quirk database ($CHIP8_QUIRK_DB or $HOME/.chip8-quirks.db), else %03x\n", chip8_cfg.quirks);
+#ifdef CHIP8_DEBUGGER
+	fprintf(stderr, "\t-d socket\tListen for a debugger UI on the Unix domain socket. See debugger.h for the protocol.\n");
+#endif
+#ifdef CHIP8_TRACE
+	fprintf(stderr, "\t-t file\tWhere to dump the instruction trace on halt. Decode it with chip8-tracedump. Default: chip8.trace\n");
+#endif
+}
+
 int main(int argc, char **argv)
 {
-	if(argc < 2) {
-		fprintf(stderr, "Usage: %s <chip8rom.ch8>\n", argv[0]);
+	uint32_t random_seed = time(NULL);
+	int opt;
+	const char *capture_path = NULL;
+	const char *debugger_path = NULL;
+	const char *quirk_db_path = chip8_quirkdb_default_path();
+	uint32_t quirks = 0;
+	uint8_t quirks_overridden = 0;
+	uint8_t seed_overridden = 0;
+	uint32_t cycles = 0;
+	const char *link_path = NULL;
+	uint32_t link_player = 1;
+	uint32_t link_delay = 0;
+#ifdef CHIP8_TRACE
+	const char *trace_path = "chip8.trace";
+#endif
+	while((opt = getopt(argc, argv, "s:c:q:i:r:l:p:L:" DEBUGGER_OPTIONS TRACE_OPTIONS)) != -1) {
+		switch(opt) {
+			case 's':
+				random_seed = strtoul(optarg, NULL, 0);
+				seed_overridden = 1;
+			break;
+			case 'c':
+				capture_path = optarg;
+			break;
+			case 'q':
+				quirks = strtoul(optarg, NULL, 16);
+				quirks_overridden = 1;
+			break;
+			case 'i':
+				cycles = strtoul(optarg, NULL, 0);
+				if(!cycles) {
+					print_usage(argv[0]);
+					return 1;
+				}
+			break;
+			case 'r':
+				run_ahead.frames_ahead = strtoul(optarg, NULL, 0);
+				if(run_ahead.frames_ahead > RUN_AHEAD_MAX_FRAMES) {
+					print_usage(argv[0]);
+					return 1;
+				}
+			break;
+			case 'l':
+				link_path = optarg;
+			break;
+			case 'p':
+				link_player = strtoul(optarg, NULL, 0);
+			break;
+			case 'L':
+				link_delay = strtoul(optarg, NULL, 0);
+			break;
+#ifdef CHIP8_DEBUGGER
+			case 'd':
+				debugger_path = optarg;
+			break;
+#endif
+#ifdef CHIP8_TRACE
+			case 't':
+				trace_path = optarg;
+			break;
+#endif
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+	if(optind >= argc) {
+		print_usage(argv[0]);
 		return 1;
 	}
+	const char *rom_path = argv[optind];
+	if(link_path) {
+		if(link_player < 1 || link_player > 2 || link_delay > CHIP8_ROLLBACK_WINDOW/2) {
+			print_usage(argv[0]);
+			return 1;
+		}
+		// Run-ahead and the debugger work an instruction at a time on the local machine, which the rollback link rewinds
+		if(run_ahead.frames_ahead || debugger_path) {
+			fprintf(stderr, "The link can't be used along with run-ahead or the debugger\n");
+			return 1;
+		}
+		if(!seed_overridden) {
+			random_seed = 0; // Both sides need the same seed. Use the default one.
+		}
+	}
 
-	srand(time(NULL));
 	chip8_init(&chip8, &chip8_cfg);
-	FILE *fp = fopen(argv[1], "r");
+	if(random_seed) {
+		chip8.periph.random_state = random_seed;
+	}
+	printf("Random seed: %u\n", chip8.periph.random_state);
+	FILE *fp = fopen(rom_path, "r");
 	if(fp == NULL) {
-		fprintf(stderr, "Failed to open the file: %s\n", argv[1]);
+		fprintf(stderr, "Failed to open the file: %s\n", rom_path);
 		return 1;
 	}
-	fread(&chip8.mem[CHIP8_PROGRAM_START_OFFSET], CHIP8_MEMORY_SIZE-CHIP8_PROGRAM_START_OFFSET, 1, fp);
+	size_t rom_size = fread(&chip8.mem[CHIP8_PROGRAM_START_OFFSET], 1, CHIP8_MEMORY_SIZE-CHIP8_PROGRAM_START_OFFSET, fp);
 	if (ferror(fp)) {
-		fprintf(stderr, "Failed to read the file's content: %s\n", argv[1]);
+		fprintf(stderr, "Failed to read the file's content: %s\n", rom_path);
 		return 1;
 	}
 	fclose(fp);
 
+	// Quirks and instructions per frame: -q and -i, else the quirk database filled by chip8-quirkscan, else the default config
+	uint32_t db_quirks;
+	uint32_t db_cycles;
+	if(quirk_db_path && chip8_quirkdb_lookup(quirk_db_path, chip8_quirkdb_hash(&chip8.mem[CHIP8_PROGRAM_START_OFFSET], rom_size), &db_quirks, &db_cycles)) {
+		if(!quirks_overridden) {
+			quirks = db_quirks;
+			quirks_overridden = 1;
+			printf("Quirks from %s\n", quirk_db_path);
+		}
+		if(!cycles && db_cycles) {
+			cycles = db_cycles;
+			printf("Instructions per frame from %s\n", quirk_db_path);
+		}
+	}
+	if(quirks_overridden) {
+		chip8.cpu.quirks = quirks;
+	}
+	printf("Quirks: %03x\n", chip8.cpu.quirks);
+	governor.target_cycles = cycles ? cycles : CYCLE_PER_FRAME;
+	governor.cycles = governor.target_cycles;
+	governor.fixed_cycles = link_path != NULL;
+	printf("Instructions per frame: %u\n", governor.target_cycles);
+
+	if(link_path) {
+		int link_fd;
+		if(link_player == 1) {
+			printf("Waiting for player 2 on: %s\n", link_path);
+			link_fd = chip8_rollback_listen(link_path);
+		} else {
+			link_fd = chip8_rollback_connect(link_path);
+		}
+		if(link_fd < 0) {
+			fprintf(stderr, "Failed to link over the socket: %s\n", link_path);
+			return 1;
+		}
+		chip8_rollback_init(&rollback, link_fd, link_player, governor.target_cycles, link_delay, &chip8);
+		linked = 1;
+		printf("Linked as player %u\n", link_player);
+	}
+
 	if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
 		fprintf(stderr, "SDL_Init Error: %s\n", SDL_GetError());
 		return EXIT_FAILURE;
@@ -106,7 +620,7 @@ int main(int argc, char **argv)
 		return EXIT_FAILURE;
 	}
 
-	SDL_Renderer* ren = SDL_CreateRenderer(win, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+	SDL_Renderer* ren = SDL_CreateRenderer(win, -1, SDL_RENDERER_ACCELERATED);
 	if (ren == NULL) {
 		fprintf(stderr, "SDL_CreateRenderer Error: %s\n", SDL_GetError());
 		SDL_DestroyWindow(win);
@@ -121,13 +635,8 @@ int main(int argc, char **argv)
 	SDL_RenderClear(ren);
 	SDL_RenderPresent(ren);
 
-	uint8_t skip_next_render = 0;
-
-	uint32_t current_tick = SDL_GetTicks();
-	uint32_t next_frame_tick = current_tick+FRAME_DURATION_MS;
-	uint16_t key_held_previous = 0;
-
-	uint32_t cycle_counter = 0;
+	static uint8_t presented_display[sizeof(chip8.periph.display)];
+	SDL_AddEventWatch(key_event_watch, NULL);
 
 	SDL_AudioSpec audio_spec;
     SDL_zero(audio_spec);
@@ -139,132 +648,167 @@ int main(int argc, char **argv)
 	SDL_AudioDeviceID audio_device = SDL_OpenAudioDevice(NULL, 0, &audio_spec, NULL, 0);
     SDL_PauseAudioDevice(audio_device, 0);
 
-	while (1) {
-		current_tick = SDL_GetTicks();
-		SDL_Event event;
-		while (SDL_PollEvent(&event)) {
-			switch(event.type) {
-				case SDL_QUIT:
-					return 0;
-				break;
+	if(capture_path && capture_start(capture_path)) {
+		fprintf(stderr, "Failed to start capturing to the file: %s\n", capture_path);
+		return EXIT_FAILURE;
+	}
+#ifdef CHIP8_DEBUGGER
+	if(debugger_path && chip8_debugger_open(&debugger, debugger_path)) {
+		fprintf(stderr, "Failed to listen for the debugger on: %s\n", debugger_path);
+		return EXIT_FAILURE;
+	}
+#endif
+
+	uint8_t running = 1;
+	uint64_t link_ticks = 0; // Time the link took to run the frame, including rollbacks. Counted as emulation time.
+	governor_start();
+	while (running) {
+		uint64_t emulation_start = SDL_GetPerformanceCounter();
+		if(!linked && !(chip8.periph.requests & (CHIP8_REQUEST_WAIT_DISPLAY_REFRESH|CHIP8_REQUEST_DEBUG_BREAK|CHIP8_REQUEST_HALT_MASK))) {
+			for(uint32_t n=0; n<governor.cycles; ) {
+				if(chip8.periph.requests & (CHIP8_REQUEST_WAIT_DISPLAY_REFRESH|CHIP8_REQUEST_DEBUG_BREAK|CHIP8_REQUEST_HALT_MASK)) {
+					break;
+				}
+				n += chip8_step_fused(&chip8, governor.cycles-n);
 			}
-		}
-		
-		// Derive key pressed states
-		const Uint8* keystate = SDL_GetKeyboardState(NULL);
-		chip8.periph.key_held =
-		(((!!keystate[SDL_SCANCODE_X])<<0) | ((!!keystate[SDL_SCANCODE_1])<<1) | ((!!keystate[SDL_SCANCODE_2])<<2) | ((!!keystate[SDL_SCANCODE_3])<<3) |
-		((!!keystate[SDL_SCANCODE_Q])<<4) | ((!!keystate[SDL_SCANCODE_W])<<5) | ((!!keystate[SDL_SCANCODE_E])<<6) | ((!!keystate[SDL_SCANCODE_A])<<7) |
-		((!!keystate[SDL_SCANCODE_S])<<8) | ((!!keystate[SDL_SCANCODE_D])<<9) | ((!!keystate[SDL_SCANCODE_Z])<<10) | ((!!keystate[SDL_SCANCODE_C])<<11) |
-		((!!keystate[SDL_SCANCODE_4])<<12) | ((!!keystate[SDL_SCANCODE_R])<<13) | ((!!keystate[SDL_SCANCODE_F])<<14) | ((!!keystate[SDL_SCANCODE_V])<<15)
-		);
-		chip8.periph.key_just_released = (key_held_previous^chip8.periph.key_held)&key_held_previous;
-		key_held_previous = chip8.periph.key_held;
-
-		chip8.periph.random_num = rand();
-		if(!(chip8.periph.requests & CHIP8_REQUEST_WAIT_DISPLAY_REFRESH)) {
-			chip8_step(&chip8);
-			chip8.periph.key_just_released = 0;
 			if(chip8.periph.requests & CHIP8_REQUEST_HALT_MASK) {
-				printf("Machine halted! Reason(s):\n");
-				if(chip8.periph.requests & CHIP8_REQUEST_HALT_EXIT_EMULATOR) {
-					printf("CHIP8_REQUEST_HALT_EXIT_EMULATOR ");
-				}
-				if(chip8.periph.requests & CHIP8_REQUEST_HALT_I_ERROR) {
-					printf("CHIP8_REQUEST_HALT_I_ERROR ");
-				}
-				if(chip8.periph.requests & CHIP8_REQUEST_HALT_STACK_ERROR) {
-					printf("CHIP8_REQUEST_HALT_STACK_ERROR ");
-				}
-				if(chip8.periph.requests & CHIP8_REQUEST_HALT_PC_ERROR) {
-					printf("CHIP8_REQUEST_HALT_PC_ERROR ");
+				print_halt_state();
+#ifdef CHIP8_TRACE
+				if(chip8_trace_dump(&chip8, trace_path)) {
+					fprintf(stderr, "Failed to dump the instruction trace to: %s\n", trace_path);
+				} else {
+					printf("Instruction trace dumped to: %s\n", trace_path);
 				}
-				if(chip8.periph.requests & CHIP8_REQUEST_HALT_INVALID_INSTRUCTION) {
-					printf("CHIP8_REQUEST_HALT_INVALID_INSTRUCTION ");
+#endif
+				if(!debugger_path) {
+					break;
 				}
-				printf("\n");
-				printf("PC0..4:\t%04x %04x %04x %04x\n", chip8.cpu.pc[0], chip8.cpu.pc[1], chip8.cpu.pc[2], chip8.cpu.pc[3]);
-				printf("PC5..8:\t%04x %04x %04x %04x\n", chip8.cpu.pc[4], chip8.cpu.pc[5], chip8.cpu.pc[6], chip8.cpu.pc[7]);
-				printf("PC9..12:\t%04x %04x %04x %04x\n", chip8.cpu.pc[8], chip8.cpu.pc[9], chip8.cpu.pc[10], chip8.cpu.pc[11]);
-				printf("PC13..16:\t%04x %04x %04x %04x\n", chip8.cpu.pc[12], chip8.cpu.pc[13], chip8.cpu.pc[14], chip8.cpu.pc[15]);
-				printf("pc_index:\t%u\n", chip8.cpu.pc_index);
-				printf("v0..7:\t%02x %02x %02x %02x %02x %02x %02x %02x\n",
-					chip8.cpu.v[0], chip8.cpu.v[1], chip8.cpu.v[2], chip8.cpu.v[3], chip8.cpu.v[4], chip8.cpu.v[5], chip8.cpu.v[6], chip8.cpu.v[7]);
-				printf("v8..15:\t%02x %02x %02x %02x %02x %02x %02x %02x\n",
-					chip8.cpu.v[8], chip8.cpu.v[9], chip8.cpu.v[10], chip8.cpu.v[11], chip8.cpu.v[12], chip8.cpu.v[13], chip8.cpu.v[14], chip8.cpu.v[15]);
-				printf("i:\t%04x\n", chip8.cpu.i);
-				break;
+				// Otherwise, the machine is kept around for the attached debugger to inspect
 			}
 		}
 
-		if(++cycle_counter >= CYCLE_PER_FRAME) {
-			while(SDL_GetTicks() < next_frame_tick) {
-				SDL_Delay(1);
-			}
+		uint64_t emulation_ticks = SDL_GetPerformanceCounter()-emulation_start + link_ticks;
+
+		running = governor_wait();
+		if(!running) {
+			break;
 		}
 
+		// The machine presented. It drives the audio too, so that the sound is as far ahead as the picture.
+		uint64_t run_ahead_start = SDL_GetPerformanceCounter();
+		const struct chip8_machine *presented = run_ahead_frames();
+
 		// Audio handling. Pitch: Not implemented. The timing is also known to be buggy.
-		if(chip8.periph.sound_timer > 0 && SDL_GetQueuedAudioSize(audio_device) < 128) {
+		if(presented->periph.sound_timer > 0 && SDL_GetQueuedAudioSize(audio_device) < 128) {
 			static uint8_t buffer[CHIP8_AUDIO_BUFFER_SIZE*8];
+			uint32_t audio[CHIP8_AUDIO_BUFFER_SIZE/4];
+			uint8_t audio_pitch;
+			chip8_audio_read(&presented->periph, audio, &audio_pitch);
 			for(size_t i=0; i<CHIP8_AUDIO_BUFFER_SIZE/4; i++) {
 				for(size_t j=0; j<32; j++) {
-					buffer[i*32 + j] = (chip8.periph.audio[i] & (1U << (31-j))) ? 255 : 0;
+					buffer[i*32 + j] = (audio[i] & (1U << (31-j))) ? 255 : 0;
 				}
 			}
 			SDL_QueueAudio(audio_device, buffer, sizeof(buffer));
 		}
+		governor_average(&governor.emulation_ticks, emulation_ticks + SDL_GetPerformanceCounter()-run_ahead_start);
 
-		if(SDL_GetTicks() >= next_frame_tick) {
-			// Render display
-			if(!skip_next_render) {
-				// Beep indicator
-				if(chip8.periph.sound_timer == 0) {
-					SDL_SetRenderDrawColor(ren, 22, 22, 22, 255);
-				} else {
-					SDL_SetRenderDrawColor(ren, 222, 222, 222, 255);
+		// Render display
+		if(governor_should_render()) {
+			uint64_t render_start = SDL_GetPerformanceCounter();
+
+			// Beep indicator
+			if(presented->periph.sound_timer == 0) {
+				SDL_SetRenderDrawColor(ren, 22, 22, 22, 255);
+			} else {
+				SDL_SetRenderDrawColor(ren, 222, 222, 222, 255);
+			}
+			SDL_Rect rect;
+			rect.x = 0;
+			rect.y = CHIP8_DISPLAY_HEIGHT*PIXEL_SCALE;
+			rect.w = CHIP8_DISPLAY_WIDTH*PIXEL_SCALE;
+			rect.h = BORDER_WIDTH;
+			SDL_RenderFillRect(ren, &rect);
+
+			// Key-to-effect latency: the first presented frame that differs from the previous one after a key event
+			if(memcmp(presented_display, presented->periph.display, sizeof(presented_display))) {
+				uint32_t key_tick = SDL_AtomicSet(&key_event_tick, 0);
+				if(key_tick) {
+					record_input_latency(SDL_GetTicks() - key_tick);
 				}
-				SDL_Rect rect;
-				rect.x = 0;
-				rect.y = CHIP8_DISPLAY_HEIGHT*PIXEL_SCALE;
-				rect.w = CHIP8_DISPLAY_WIDTH*PIXEL_SCALE;
-				rect.h = BORDER_WIDTH;
-				SDL_RenderFillRect(ren, &rect);
-
-				// Draw display content
-				for(size_t x=0; x<CHIP8_DISPLAY_WIDTH; x++) {
-					for(size_t y=0; y<CHIP8_DISPLAY_HEIGHT; y++) {
-						if(chip8.periph.display[(x*CHIP8_DISPLAY_HEIGHT+y)/8] & (1<<(y%8))) {
-							SDL_SetRenderDrawColor(ren, 255, 255, 255, 255);
-						} else {
-							SDL_SetRenderDrawColor(ren, 0, 0, 0, 255);
-						}
-						SDL_Rect rect;
-						rect.x = x*PIXEL_SCALE;
-						rect.y = y*PIXEL_SCALE;
-						rect.w = PIXEL_SCALE;
-						rect.h = PIXEL_SCALE;
-						SDL_RenderFillRect(ren, &rect);
+				memcpy(presented_display, presented->periph.display, sizeof(presented_display));
+			}
+
+			// Draw display content
+			for(size_t x=0; x<CHIP8_DISPLAY_WIDTH; x++) {
+				for(size_t y=0; y<CHIP8_DISPLAY_HEIGHT; y++) {
+					if(presented->periph.display[(x*CHIP8_DISPLAY_HEIGHT+y)/8] & (1<<(y%8))) {
+						SDL_SetRenderDrawColor(ren, 255, 255, 255, 255);
+					} else {
+						SDL_SetRenderDrawColor(ren, 0, 0, 0, 255);
 					}
+					SDL_Rect rect;
+					rect.x = x*PIXEL_SCALE;
+					rect.y = y*PIXEL_SCALE;
+					rect.w = PIXEL_SCALE;
+					rect.h = PIXEL_SCALE;
+					SDL_RenderFillRect(ren, &rect);
 				}
-				SDL_RenderPresent(ren);
 			}
+			SDL_RenderPresent(ren);
+			governor_average(&governor.render_ticks, SDL_GetPerformanceCounter()-render_start);
+		}
+		if(!linked) {
 			chip8.periph.requests &= ~CHIP8_REQUEST_WAIT_DISPLAY_REFRESH;
 
-			// Handle timers
-			chip8_timer_step(&chip8);
-			next_frame_tick += FRAME_DURATION_MS;
+			// Handle timers. They're frozen while the debugger has the machine stopped.
+			if(!(chip8.periph.requests & CHIP8_REQUEST_DEBUG_BREAK)) {
+				chip8_timer_step(&chip8);
+			}
+		}
+		if(capture_path) {
+			capture_push(&chip8);
+		}
+		governor_end_frame();
 
-			if(SDL_GetTicks() < next_frame_tick) {
-				skip_next_render = 0;
-			} else {
-				// Our emulator is lagging. Skipping the next frame rendering
-				printf("skip! %u\n", SDL_GetTicks());
-				skip_next_render = 1;
+		// Release edges that haven't been consumed by FX0A within a frame are dropped.
+		// Edges that occurred since then are latched in key_released_atomic until now.
+		running = process_events();
+		chip8.periph.key_held = SDL_AtomicGet(&key_held_atomic);
+		chip8.periph.key_just_released = SDL_AtomicSet(&key_released_atomic, 0);
+		if(linked) {
+			// Runs the whole next frame, to be presented on the next frame boundary. A stall repeats the frame.
+			uint64_t link_start = SDL_GetPerformanceCounter();
+			int link_result = chip8_rollback_advance(&rollback, &chip8, chip8.periph.key_held, chip8.periph.key_just_released);
+			link_ticks = SDL_GetPerformanceCounter()-link_start;
+			if(link_result < 0) {
+				fprintf(stderr, "The link is broken, or the other side runs a different ROM, quirks, seed or instructions per frame\n");
+				running = 0;
+			} else if(chip8.periph.requests & CHIP8_REQUEST_HALT_MASK) {
+				print_halt_state();
+				running = 0;
 			}
-			cycle_counter = 0;
 		}
+#ifdef CHIP8_DEBUGGER
+		if(debugger_path) {
+			chip8_debugger_poll(&debugger, &chip8);
+		}
+#endif
 	}
 
+	print_stats();
+	if(capture_path) {
+		capture_stop();
+	}
+	if(linked) {
+		chip8_rollback_close(&rollback);
+	}
+#ifdef CHIP8_DEBUGGER
+	if(debugger_path) {
+		chip8_debugger_close(&debugger);
+	}
+#endif
+	SDL_DelEventWatch(key_event_watch, NULL);
 	SDL_DestroyRenderer(ren);
 	SDL_DestroyWindow(win);
 	SDL_Quit();
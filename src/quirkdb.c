@@ -0,0 +1,110 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "quirkdb.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+uint64_t chip8_quirkdb_hash(const uint8_t *rom, size_t size) {
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	for(size_t n=0; n<size; n++) {
+		hash = (hash ^ rom[n]) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+const char *chip8_quirkdb_default_path(void) {
+	static char path[4096];
+	const char *env = getenv("CHIP8_QUIRK_DB");
+	if(env) {
+		return env;
+	}
+	env = getenv("HOME");
+	if(env == NULL || snprintf(path, sizeof(path), "%s/.chip8-quirks.db", env) >= (int)sizeof(path)) {
+		return NULL;
+	}
+	return path;
+}
+
+int chip8_quirkdb_lookup(const char *path, uint64_t hash, uint32_t *quirks, uint32_t *cycles) {
+	FILE *fp = fopen(path, "r");
+	if(fp == NULL) {
+		return 0;
+	}
+	char line[128];
+	int found = 0;
+	while(!found && fgets(line, sizeof(line), fp)) {
+		uint64_t line_hash;
+		uint32_t line_quirks;
+		uint32_t line_cycles = 0;
+		if(sscanf(line, "%" SCNx64 " %" SCNx32 " %" SCNu32, &line_hash, &line_quirks, &line_cycles) >= 2 && line_hash == hash) {
+			*quirks = line_quirks;
+			*cycles = line_cycles;
+			found = 1;
+		}
+	}
+	fclose(fp);
+	return found;
+}
+
+int chip8_quirkdb_store(const char *path, uint64_t hash, uint32_t quirks, uint32_t cycles) {
+	// Rewritten into a temporary file, then renamed over the database, so that it's never left half-written
+	char temp_path[4096];
+	if(snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) {
+		return -1;
+	}
+	FILE *out = fopen(temp_path, "w");
+	if(out == NULL) {
+		return -1;
+	}
+	FILE *in = fopen(path, "r");
+	if(in) {
+		char line[128];
+		while(fgets(line, sizeof(line), in)) {
+			uint64_t line_hash;
+			if(sscanf(line, "%" SCNx64, &line_hash) == 1 && line_hash == hash) {
+				continue;
+			}
+			fputs(line, out);
+		}
+		fclose(in);
+	}
+	if(cycles) {
+		fprintf(out, "%016" PRIx64 " %" PRIx32 " %" PRIu32 "\n", hash, quirks, cycles);
+	} else {
+		fprintf(out, "%016" PRIx64 " %" PRIx32 "\n", hash, quirks);
+	}
+	if(fclose(out) || rename(temp_path, path)) {
+		remove(temp_path);
+		return -1;
+	}
+	return 0;
+}
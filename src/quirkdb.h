@@ -0,0 +1,48 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CHIP8_QUIRKDB_H
+#define CHIP8_QUIRKDB_H
+
+// Database of quirks per ROM, keyed by the hash of the ROM. Filled by chip8-quirkscan and read by the emulator on
+// boot. It's a text file, one ROM per line: hash (16 hex digits), quirks (hex) and optionally the instructions per
+// frame that the ROM needs (decimal), separated by spaces.
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint64_t chip8_quirkdb_hash(const uint8_t *rom, size_t size);
+// $CHIP8_QUIRK_DB if set, $HOME/.chip8-quirks.db otherwise. NULL if neither is set.
+const char *chip8_quirkdb_default_path(void);
+// Returns 1 if found, 0 if not found or the database doesn't exist. cycles is set to 0 if the entry has none.
+int chip8_quirkdb_lookup(const char *path, uint64_t hash, uint32_t *quirks, uint32_t *cycles);
+// Adds or replaces the entry of the ROM. cycles is the instructions per frame that the quirks were picked at, 0 for none.
+// Returns 0 on success, -1 on error.
+int chip8_quirkdb_store(const char *path, uint64_t hash, uint32_t quirks, uint32_t cycles);
+
+#endif
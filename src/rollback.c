@@ -0,0 +1,243 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "rollback.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static void chip8_rollback_put_u32(uint8_t *p, uint32_t value) {
+	p[0] = value;
+	p[1] = value >> 8;
+	p[2] = value >> 16;
+	p[3] = value >> 24;
+}
+
+static uint32_t chip8_rollback_get_u32(const uint8_t *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// FNV-1a
+static uint32_t chip8_rollback_hash(uint32_t hash, const uint8_t *data, size_t size) {
+	for(size_t n=0; n<size; n++) {
+		hash = (hash ^ data[n]) * 16777619U;
+	}
+	return hash;
+}
+
+static int chip8_rollback_address(struct sockaddr_un *addr, const char *path) {
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if(strlen(path) >= sizeof(addr->sun_path)) {
+		return -1;
+	}
+	strcpy(addr->sun_path, path);
+	return 0;
+}
+
+int chip8_rollback_listen(const char *path) {
+	struct sockaddr_un addr;
+	if(chip8_rollback_address(&addr, path)) {
+		return -1;
+	}
+	int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(listen_fd < 0) {
+		return -1;
+	}
+	unlink(path);
+	if(bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) || listen(listen_fd, 1)) {
+		close(listen_fd);
+		return -1;
+	}
+	int fd = accept(listen_fd, NULL, NULL);
+	close(listen_fd);
+	unlink(path);
+	return fd;
+}
+
+int chip8_rollback_connect(const char *path) {
+	struct sockaddr_un addr;
+	if(chip8_rollback_address(&addr, path)) {
+		return -1;
+	}
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0) {
+		return -1;
+	}
+	if(connect(fd, (struct sockaddr*)&addr, sizeof(addr))) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+void chip8_rollback_init(struct chip8_rollback *link, int fd, uint8_t player, uint32_t cycles, uint32_t delay, const struct chip8_machine *machine) {
+	memset(link, 0, sizeof(*link));
+	link->fd = fd;
+	link->local_keys = player == 1 ? CHIP8_ROLLBACK_PLAYER1_KEYS : CHIP8_ROLLBACK_PLAYER2_KEYS;
+	link->cycles = cycles;
+	link->delay = delay;
+	link->mispredicted = UINT32_MAX;
+	uint8_t seed[12];
+	chip8_rollback_put_u32(&seed[0], machine->cpu.quirks);
+	chip8_rollback_put_u32(&seed[4], machine->periph.random_state);
+	chip8_rollback_put_u32(&seed[8], cycles);
+	link->hash = chip8_rollback_hash(chip8_rollback_hash(2166136261U, machine->mem, sizeof(machine->mem)), seed, sizeof(seed));
+}
+
+// Returns 0 if sent, 1 if the socket is full, -1 on error
+static int chip8_rollback_send(struct chip8_rollback *link, const uint8_t *message) {
+	ssize_t sent = send(link->fd, message, CHIP8_ROLLBACK_MESSAGE_SIZE, MSG_DONTWAIT|MSG_NOSIGNAL);
+	if(sent == CHIP8_ROLLBACK_MESSAGE_SIZE) {
+		return 0;
+	}
+	if(sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+		return 1;
+	}
+	// A partial message can't be taken back
+	return -1;
+}
+
+static int chip8_rollback_receive(struct chip8_rollback *link) {
+	// Inputs of the frames not run yet are left in the socket, so that the rings never hold more than a window
+	while(!link->peer_ready || link->confirmed < link->frame) {
+		ssize_t received = recv(link->fd, &link->in[link->in_size], sizeof(link->in)-link->in_size, MSG_DONTWAIT);
+		if(received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+			return 0;
+		}
+		if(received <= 0) {
+			return -1;
+		}
+		link->in_size += received;
+		if(link->in_size < sizeof(link->in)) {
+			continue;
+		}
+		link->in_size = 0;
+
+		if(!link->peer_ready) {
+			if(memcmp(link->in, "C8LK", 4) || chip8_rollback_get_u32(&link->in[4]) != link->hash) {
+				return -1;
+			}
+			link->peer_ready = 1;
+			continue;
+		}
+		if(chip8_rollback_get_u32(&link->in[0]) != link->confirmed) {
+			return -1;
+		}
+		struct chip8_rollback_input input;
+		input.held = (link->in[4] | (link->in[5] << 8)) & ~link->local_keys;
+		input.released = (link->in[6] | (link->in[7] << 8)) & ~link->local_keys;
+		struct chip8_rollback_input *predicted = &link->remote[link->confirmed % CHIP8_ROLLBACK_WINDOW];
+		if((predicted->held != input.held || predicted->released != input.released) && link->confirmed < link->mispredicted) {
+			link->mispredicted = link->confirmed;
+		}
+		*predicted = input;
+		link->last_remote_held = input.held;
+		link->confirmed++;
+	}
+	return 0;
+}
+
+static void chip8_rollback_run_frame(struct chip8_rollback *link, struct chip8_machine *machine, uint32_t frame) {
+	struct chip8_rollback_input *local = &link->local[frame % CHIP8_ROLLBACK_WINDOW];
+	struct chip8_rollback_input *remote = &link->remote[frame % CHIP8_ROLLBACK_WINDOW];
+	if(frame >= link->confirmed) {
+		remote->held = link->last_remote_held;
+		remote->released = 0;
+	}
+	link->snapshots[frame % CHIP8_ROLLBACK_WINDOW] = *machine;
+	machine->periph.key_held = local->held | remote->held;
+	machine->periph.key_just_released = local->released | remote->released;
+	chip8_run_frame(machine, link->cycles);
+}
+
+int chip8_rollback_advance(struct chip8_rollback *link, struct chip8_machine *machine, uint16_t held, uint16_t released) {
+	if(!link->hello_sent) {
+		uint8_t hello[CHIP8_ROLLBACK_MESSAGE_SIZE];
+		memcpy(hello, "C8LK", 4);
+		chip8_rollback_put_u32(&hello[4], link->hash);
+		if(chip8_rollback_send(link, hello)) {
+			return -1;
+		}
+		link->hello_sent = 1;
+	}
+	if(chip8_rollback_receive(link)) {
+		return -1;
+	}
+
+	if(link->mispredicted != UINT32_MAX) {
+		uint32_t depth = link->frame - link->mispredicted;
+		*machine = link->snapshots[link->mispredicted % CHIP8_ROLLBACK_WINDOW];
+		for(uint32_t frame=link->mispredicted; frame<link->frame; frame++) {
+			chip8_rollback_run_frame(link, machine, frame);
+		}
+		link->mispredicted = UINT32_MAX;
+		link->rollbacks++;
+		link->frames_resimulated += depth;
+		if(depth > link->max_rollback_frames) {
+			link->max_rollback_frames = depth;
+		}
+	}
+
+	int result = 1;
+	if(link->frame - link->confirmed < CHIP8_ROLLBACK_WINDOW-1 && link->frame - link->sent < CHIP8_ROLLBACK_WINDOW-1) {
+		struct chip8_rollback_input *local = &link->local[link->frame % CHIP8_ROLLBACK_WINDOW];
+		local->held = held & link->local_keys;
+		local->released = released & link->local_keys;
+		chip8_rollback_run_frame(link, machine, link->frame);
+		link->frame++;
+		result = 0;
+	} else {
+		link->stalls++;
+	}
+
+	while(link->sent + link->delay < link->frame) {
+		const struct chip8_rollback_input *local = &link->local[link->sent % CHIP8_ROLLBACK_WINDOW];
+		uint8_t message[CHIP8_ROLLBACK_MESSAGE_SIZE];
+		chip8_rollback_put_u32(&message[0], link->sent);
+		message[4] = local->held;
+		message[5] = local->held >> 8;
+		message[6] = local->released;
+		message[7] = local->released >> 8;
+		int sent = chip8_rollback_send(link, message);
+		if(sent < 0) {
+			return -1;
+		}
+		if(sent > 0) {
+			break;
+		}
+		link->sent++;
+	}
+	return result;
+}
+
+void chip8_rollback_close(struct chip8_rollback *link) {
+	close(link->fd);
+}
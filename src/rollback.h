@@ -0,0 +1,96 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CHIP8_ROLLBACK_H
+#define CHIP8_ROLLBACK_H
+
+// Rollback link of two machines sharing the keypad, one player on each side.
+//
+// Both sides run the same ROM with the same quirks, random seed and instructions per frame, frame by frame. Each frame, the local keys are sent
+// to the other side, and the remote keys that haven't arrived yet are predicted to be the last ones received. Once the
+// actual remote keys of a mispredicted frame arrive, the machine is restored to its snapshot at that frame and
+// re-simulated up to the current frame. The local side stalls if it gets CHIP8_ROLLBACK_WINDOW-1 frames ahead of the
+// remote keys received, or of the local keys sent.
+//
+// Stream protocol. All integers are little-endian.
+//   hello: magic "C8LK", hash of the machine's memory, quirks, random seed and cycles per frame (4 bytes). Sent once by both sides.
+//   input: frame number (4 bytes), keys held (2 bytes), keys just released (2 bytes). Sent for every frame, in order.
+
+#include "chip8.h"
+#include <stddef.h>
+
+#define CHIP8_ROLLBACK_WINDOW (16U) // Must be a power of two
+#define CHIP8_ROLLBACK_MESSAGE_SIZE (8U)
+
+// Keys of each player
+#define CHIP8_ROLLBACK_PLAYER1_KEYS (0x00FFU)
+#define CHIP8_ROLLBACK_PLAYER2_KEYS (0xFF00U)
+
+struct chip8_rollback_input {
+	uint16_t held;
+	uint16_t released;
+};
+
+struct chip8_rollback {
+	int fd;
+	uint16_t local_keys; // CHIP8_ROLLBACK_PLAYER*_KEYS
+	uint32_t cycles; // Per frame
+	uint32_t delay; // Frames the local keys are held back before being sent, for testing. At most CHIP8_ROLLBACK_WINDOW/2.
+	uint32_t hash; // Of the initial machine. The peer must have the same.
+	uint8_t peer_ready; // Whether the peer's hello has been received
+	uint8_t hello_sent;
+	uint32_t frame; // Number of frames run
+	uint32_t confirmed; // The remote inputs of all the frames before it have been received. Never more than frame.
+	uint32_t sent; // The local inputs of all the frames before it have been sent
+	uint32_t mispredicted; // Earliest frame run with a wrong prediction of the remote keys. UINT32_MAX if none.
+	uint16_t last_remote_held; // Prediction of the remote keys held
+	// Indexed by frame % CHIP8_ROLLBACK_WINDOW
+	struct chip8_rollback_input local[CHIP8_ROLLBACK_WINDOW];
+	struct chip8_rollback_input remote[CHIP8_ROLLBACK_WINDOW]; // Received, or predicted beyond confirmed
+	struct chip8_machine snapshots[CHIP8_ROLLBACK_WINDOW]; // State at the start of the frame
+	uint8_t in[CHIP8_ROLLBACK_MESSAGE_SIZE];
+	size_t in_size;
+	// Stats
+	uint32_t rollbacks;
+	uint32_t frames_resimulated;
+	uint32_t max_rollback_frames;
+	uint32_t stalls;
+};
+
+// Unix domain socket transport. Player 1 listens and waits for player 2 to connect. Return the connected socket, -1 on error.
+int chip8_rollback_listen(const char *path);
+int chip8_rollback_connect(const char *path);
+
+// Takes over fd. player is 1 or 2. The machine must be freshly loaded with the ROM.
+void chip8_rollback_init(struct chip8_rollback *link, int fd, uint8_t player, uint32_t cycles, uint32_t delay, const struct chip8_machine *machine);
+// Runs the next frame with the local keys (the other player's keys are masked out), rolling back first if needed.
+// Returns 0 if a frame is run, 1 if stalled waiting for the remote inputs, -1 if the link is broken or the peer differs.
+int chip8_rollback_advance(struct chip8_rollback *link, struct chip8_machine *machine, uint16_t held, uint16_t released);
+void chip8_rollback_close(struct chip8_rollback *link);
+
+#endif
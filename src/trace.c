@@ -0,0 +1,71 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "trace.h"
+#include <stdio.h>
+#include <string.h>
+
+static void chip8_trace_put_u16(uint8_t *p, uint16_t value) {
+	p[0] = value;
+	p[1] = value >> 8;
+}
+
+static void chip8_trace_put_u32(uint8_t *p, uint32_t value) {
+	chip8_trace_put_u16(p, value);
+	chip8_trace_put_u16(&p[2], value >> 16);
+}
+
+int chip8_trace_dump(const struct chip8_machine *machine, const char *path) {
+	const struct chip8_trace *trace = &machine->trace;
+	uint32_t count = trace->count < CHIP8_TRACE_SIZE ? trace->count : CHIP8_TRACE_SIZE;
+	FILE *fp = fopen(path, "wb");
+	if(fp == NULL) {
+		return -1;
+	}
+	uint8_t header[CHIP8_TRACE_FILE_HEADER_SIZE];
+	memcpy(header, "C8TRACE1", 8);
+	chip8_trace_put_u32(&header[8], count);
+	chip8_trace_put_u32(&header[12], trace->count-count);
+	int ret = fwrite(header, sizeof(header), 1, fp) == 1 ? 0 : -1;
+	for(uint32_t n=trace->count-count; n!=trace->count; n++) {
+		const struct chip8_trace_record *record = &trace->records[n & (CHIP8_TRACE_SIZE-1)];
+		uint8_t bytes[CHIP8_TRACE_FILE_RECORD_SIZE];
+		chip8_trace_put_u16(&bytes[0], record->pc);
+		chip8_trace_put_u16(&bytes[2], record->instruction);
+		chip8_trace_put_u16(&bytes[4], record->i);
+		bytes[6] = record->vx;
+		bytes[7] = record->vf;
+		if(fwrite(bytes, sizeof(bytes), 1, fp) != 1) {
+			ret = -1;
+		}
+	}
+	if(fclose(fp)) {
+		ret = -1;
+	}
+	return ret;
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CHIP8_TRACE_FILE_H
+#define CHIP8_TRACE_FILE_H
+
+// Trace file, written on halt by builds with CHIP8_TRACE and decoded by chip8-tracedump. All integers are little-endian.
+//   magic "C8TRACE1", record count (4 bytes), number of instructions run before the first record (4 bytes)
+//   records, oldest first, CHIP8_TRACE_FILE_RECORD_SIZE bytes each:
+//     pc (2 bytes), instruction (2 bytes), i before the instruction (2 bytes), vx and vf after it (1 byte each).
+//     See struct chip8_trace_record.
+
+#include "chip8.h"
+
+#define CHIP8_TRACE_FILE_HEADER_SIZE (16U)
+#define CHIP8_TRACE_FILE_RECORD_SIZE (8U)
+
+#ifdef CHIP8_TRACE
+int chip8_trace_dump(const struct chip8_machine *machine, const char *path); // -1 on error
+#endif
+
+#endif
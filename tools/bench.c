@@ -0,0 +1,285 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Microbenchmarks of chip8_step(), one opcode family at a time. Each benchmark generates a synthetic ROM that runs
+// the opcode under test back to back in a loop, and measures it per quirk profile. The time per op is the mean of
+// the samples, with its 95% confidence interval. The loop costs one jump (plus the loop setup, if any) per
+// BENCH_OPS_PER_LOOP ops, which is included.
+//
+// DXYN is measured without waiting for VBLANK, even with CHIP8_QUIRK_VBLANK.
+
+#include "config.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_MAX_COUNT (256U)
+#define BENCH_OPS_PER_LOOP (64U)
+#define BENCH_CODE_START (0x200U) // Setup, the loop, then the jump back
+#define BENCH_SUBROUTINE (0xE00U) // 00EE, for 2NNN
+#define BENCH_DATA (0x800U) // I points here. Filled with a sprite-like pattern.
+#define BENCH_DATA_SIZE (0x600U)
+#define BENCH_MAX_SAMPLES (1000U)
+
+struct bench {
+	char name[32];
+	uint16_t setup[4]; // Run once
+	uint8_t setup_count;
+	uint16_t loop_setup; // Run once per loop if not 0, e.g. to reset I
+	uint16_t op;
+};
+
+static struct bench benches[BENCH_MAX_COUNT];
+static size_t bench_count;
+
+static const struct {
+	const char *name;
+	uint32_t quirks;
+} profiles[] = {
+	{"vip", CHIP8_QUIRK_PLATFORM_VIP},
+	{"schip", CHIP8_QUIRK_PLATFORM_SCHIP},
+	{"xochip", CHIP8_QUIRK_PLATFORM_XOCHIP},
+};
+
+static struct bench *bench_add(uint16_t op, const char *format, ...) {
+	struct bench *bench = &benches[bench_count++];
+	memset(bench, 0, sizeof(*bench));
+	va_list args;
+	va_start(args, format);
+	vsnprintf(bench->name, sizeof(bench->name), format, args);
+	va_end(args);
+	bench->op = op;
+	bench->setup[bench->setup_count++] = 0xA000 | BENCH_DATA;
+	return bench;
+}
+
+static void bench_add_setup(struct bench *bench, uint16_t op) {
+	bench->setup[bench->setup_count++] = op;
+}
+
+static void generate_benches(void) {
+	static const char *modes[] = {"lores", "hires"};
+	static const uint8_t sizes[] = {1, 4, 8, 15, 0};
+	for(uint8_t hires=0; hires<2; hires++) {
+		for(size_t s=0; s<sizeof(sizes); s++) {
+			for(uint8_t edge=0; edge<2; edge++) {
+				// The sprite is drawn at V0, V1. At the edge, it wraps or gets clipped depending on CHIP8_QUIRK_WRAP.
+				struct bench *bench = bench_add(0xD010 | sizes[s], "D01%X %s %s", sizes[s], modes[hires], edge ? "edge" : "inside");
+				if(hires) {
+					bench_add_setup(bench, 0x00FF);
+				}
+				uint8_t x = edge ? (hires ? 124 : 60) : (hires ? 40 : 20);
+				uint8_t y = edge ? (hires ? 60 : 28) : (hires ? 20 : 10);
+				bench_add_setup(bench, 0x6000 | x);
+				bench_add_setup(bench, 0x6100 | y);
+			}
+		}
+	}
+	static const uint16_t screen_ops[] = {0x00E0, 0x00C4, 0x00D4, 0x00FB, 0x00FC};
+	for(uint8_t hires=0; hires<2; hires++) {
+		for(size_t n=0; n<sizeof(screen_ops)/sizeof(screen_ops[0]); n++) {
+			struct bench *bench = bench_add(screen_ops[n], "%04X %s", screen_ops[n], modes[hires]);
+			if(hires) {
+				bench_add_setup(bench, 0x00FF);
+			}
+		}
+	}
+	for(uint8_t x=0; x<16; x++) {
+		bench_add(0xF055 | (x << 8), "F%X55", x)->loop_setup = 0xA000 | BENCH_DATA;
+	}
+	for(uint8_t x=0; x<16; x++) {
+		bench_add(0xF065 | (x << 8), "F%X65", x)->loop_setup = 0xA000 | BENCH_DATA;
+	}
+	static const uint16_t range_ops[] = {0x5012, 0x5072, 0x50F2, 0x5F02, 0x5013, 0x5073, 0x50F3, 0x5F03};
+	for(size_t n=0; n<sizeof(range_ops)/sizeof(range_ops[0]); n++) {
+		bench_add(range_ops[n], "%04X", range_ops[n]);
+	}
+	bench_add(0xF033, "F033");
+	static const uint8_t alu_ops[] = {0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xE};
+	for(size_t n=0; n<sizeof(alu_ops); n++) {
+		bench_add(0x8120 | alu_ops[n], "812%X", alu_ops[n]);
+	}
+	static const uint16_t misc_ops[] = {0x6012, 0x7001, 0xA800, 0xC0FF, 0x3000, 0x5010, 0xE09E, 0xF007, 0xF015, 0xF01E, 0xF029, 0xF030};
+	for(size_t n=0; n<sizeof(misc_ops)/sizeof(misc_ops[0]); n++) {
+		bench_add(misc_ops[n], "%04X", misc_ops[n]);
+	}
+	bench_add(0x2000 | BENCH_SUBROUTINE, "2NNN;00EE");
+}
+
+static void bench_load(const struct bench *bench, uint32_t quirks, struct chip8_machine *machine) {
+	chip8_init(machine, &chip8_cfg);
+	machine->cpu.quirks = quirks;
+	uint8_t *mem = machine->mem;
+	for(uint16_t n=0; n<BENCH_DATA_SIZE; n++) {
+		mem[BENCH_DATA+n] = n*0x5B;
+	}
+	mem[BENCH_SUBROUTINE] = 0x00;
+	mem[BENCH_SUBROUTINE+1] = 0xEE;
+	// Nonzero operands, small enough to index fonts and keys
+	for(uint8_t x=0; x<16; x++) {
+		machine->cpu.v[x] = x+1;
+	}
+
+	uint16_t address = BENCH_CODE_START;
+	#define BENCH_EMIT(opcode) do { mem[address] = (opcode) >> 8; mem[address+1] = (opcode); address += 2; } while(0)
+	for(uint8_t n=0; n<bench->setup_count; n++) {
+		BENCH_EMIT(bench->setup[n]);
+	}
+	uint16_t loop = address;
+	if(bench->loop_setup) {
+		BENCH_EMIT(bench->loop_setup);
+	}
+	for(uint32_t n=0; n<BENCH_OPS_PER_LOOP; n++) {
+		BENCH_EMIT(bench->op);
+	}
+	BENCH_EMIT(0x1000 | loop);
+	#undef BENCH_EMIT
+}
+
+// Returns -1 if the machine halted
+static int bench_run(struct chip8_machine *machine, uint32_t steps) {
+	for(uint32_t n=0; n<steps; n++) {
+		chip8_step(machine);
+	}
+	machine->periph.requests &= ~CHIP8_REQUEST_WAIT_DISPLAY_REFRESH;
+	return machine->cpu.halt ? -1 : 0;
+}
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+// Two-sided 95% quantile of Student's t distribution with n-1 degrees of freedom
+static double t95(uint32_t n) {
+	static const double table[] = {0, 0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+		2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+		2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045};
+	return n < sizeof(table)/sizeof(table[0]) ? table[n] : 1.96 + 2.4/n;
+}
+
+static void print_usage(const char *program) {
+	fprintf(stderr, "Usage: %s [options]\n", program);
+	fprintf(stderr, "\t-q profile\tQuirk profile to run: vip, schip, xochip, or a CHIP8_QUIRK_* mask in hex. Default: all of the named ones\n");
+	fprintf(stderr, "\t-b name\tOnly run the benchmarks whose name starts with this\n");
+	fprintf(stderr, "\t-n steps\tInstructions per sample. Default: 20000\n");
+	fprintf(stderr, "\t-r samples\tSamples per benchmark, up to %u. Default: 30\n", BENCH_MAX_SAMPLES);
+}
+
+int main(int argc, char **argv) {
+	const char *profile_name = NULL;
+	const char *filter = "";
+	uint32_t steps = 20000;
+	uint32_t samples = 30;
+	int opt;
+	while((opt = getopt(argc, argv, "q:b:n:r:")) != -1) {
+		switch(opt) {
+			case 'q':
+				profile_name = optarg;
+			break;
+			case 'b':
+				filter = optarg;
+			break;
+			case 'n':
+				steps = strtoul(optarg, NULL, 0);
+			break;
+			case 'r':
+				samples = strtoul(optarg, NULL, 0);
+			break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+	if(optind < argc || samples < 2 || samples > BENCH_MAX_SAMPLES || !steps) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	struct {
+		char name[16];
+		uint32_t quirks;
+	} selected[sizeof(profiles)/sizeof(profiles[0])];
+	size_t selected_count = 0;
+	for(size_t p=0; p<sizeof(profiles)/sizeof(profiles[0]); p++) {
+		if(profile_name == NULL || !strcmp(profile_name, profiles[p].name)) {
+			snprintf(selected[selected_count].name, sizeof(selected[selected_count].name), "%s", profiles[p].name);
+			selected[selected_count++].quirks = profiles[p].quirks;
+		}
+	}
+	if(!selected_count) {
+		char *end;
+		uint32_t quirks = strtoul(profile_name, &end, 16);
+		if(*end != '\0' || end == profile_name) {
+			print_usage(argv[0]);
+			return 1;
+		}
+		snprintf(selected[0].name, sizeof(selected[0].name), "%03x", quirks);
+		selected[selected_count++].quirks = quirks;
+	}
+
+	generate_benches();
+	static struct chip8_machine machine;
+	static double ns[BENCH_MAX_SAMPLES];
+	printf("%-8s %-24s %10s %10s\n", "profile", "benchmark", "ns/op", "95% CI");
+	for(size_t p=0; p<selected_count; p++) {
+		for(size_t b=0; b<bench_count; b++) {
+			const struct bench *bench = &benches[b];
+			if(strncmp(bench->name, filter, strlen(filter))) {
+				continue;
+			}
+			bench_load(bench, selected[p].quirks, &machine);
+			// Warm-up, which also catches the ROMs that halt under the profile
+			if(bench_run(&machine, steps/10 + BENCH_OPS_PER_LOOP)) {
+				printf("%-8s %-24s %10s (%08x)\n", selected[p].name, bench->name, "halted", (uint32_t)machine.periph.requests);
+				continue;
+			}
+			double sum = 0;
+			for(uint32_t s=0; s<samples; s++) {
+				double start = now_ns();
+				bench_run(&machine, steps);
+				ns[s] = (now_ns()-start)/steps;
+				sum += ns[s];
+			}
+			double mean = sum/samples;
+			double variance = 0;
+			for(uint32_t s=0; s<samples; s++) {
+				variance += (ns[s]-mean)*(ns[s]-mean);
+			}
+			variance /= samples-1;
+			printf("%-8s %-24s %10.2f %9.2f%s\n", selected[p].name, bench->name, mean, t95(samples)*sqrt(variance/samples),
+				machine.cpu.halt ? " halted" : "");
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,192 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Renders a gameplay capture offline: the display into a YUV4MPEG2 video, which can be played or converted by
+// most video tools, and optionally the audio into a WAV file.
+
+#include "capture.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FRAME_RATE (60U)
+#define WAV_SAMPLE_RATE (44100U)
+#define WAV_SAMPLES_PER_FRAME (WAV_SAMPLE_RATE/FRAME_RATE)
+
+static void put_u16(uint8_t *p, uint16_t value) {
+	p[0] = value;
+	p[1] = value >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t value) {
+	put_u16(p, value);
+	put_u16(&p[2], value >> 16);
+}
+
+static void write_wav_header(FILE *fp, uint32_t sample_count) {
+	uint8_t header[44];
+	memcpy(&header[0], "RIFF", 4);
+	put_u32(&header[4], 36+sample_count);
+	memcpy(&header[8], "WAVEfmt ", 8);
+	put_u32(&header[16], 16);
+	put_u16(&header[20], 1); // PCM
+	put_u16(&header[22], 1); // mono
+	put_u32(&header[24], WAV_SAMPLE_RATE);
+	put_u32(&header[28], WAV_SAMPLE_RATE);
+	put_u16(&header[32], 1);
+	put_u16(&header[34], 8);
+	memcpy(&header[36], "data", 4);
+	put_u32(&header[40], sample_count);
+	fwrite(header, sizeof(header), 1, fp);
+}
+
+static void write_video_frame(FILE *fp, const struct chip8_capture_frame *frame, unsigned int scale) {
+	static uint8_t row[CHIP8_DISPLAY_WIDTH*16];
+	fputs("FRAME\n", fp);
+	for(size_t y=0; y<CHIP8_DISPLAY_HEIGHT; y++) {
+		for(size_t x=0; x<CHIP8_DISPLAY_WIDTH; x++) {
+			uint8_t lit = frame->display[(x*CHIP8_DISPLAY_HEIGHT+y)/8] & (1<<(y%8));
+			memset(&row[x*scale], lit ? 235 : 16, scale);
+		}
+		for(size_t n=0; n<scale; n++) {
+			fwrite(row, CHIP8_DISPLAY_WIDTH*scale, 1, fp);
+		}
+	}
+}
+
+static void write_audio_frame(FILE *fp, const struct chip8_capture_frame *frame, double *phase) {
+	uint8_t samples[WAV_SAMPLES_PER_FRAME];
+	if(!frame->sound) {
+		memset(samples, 128, sizeof(samples));
+		*phase = 0;
+	} else {
+		// Pattern playback rate as specified by XO-Chip
+		double bits_per_sample = 4000*pow(2, (frame->audio_pitch-64)/48.0)/WAV_SAMPLE_RATE;
+		for(size_t n=0; n<WAV_SAMPLES_PER_FRAME; n++) {
+			size_t bit = (size_t)*phase % (CHIP8_AUDIO_BUFFER_SIZE*8);
+			samples[n] = (frame->audio[bit/32] & (1U << (31-bit%32))) ? 255 : 0;
+			*phase = fmod(*phase+bits_per_sample, CHIP8_AUDIO_BUFFER_SIZE*8);
+		}
+	}
+	fwrite(samples, sizeof(samples), 1, fp);
+}
+
+static void print_usage(const char *program) {
+	fprintf(stderr, "Usage: %s [options] <capture> <output.y4m>\n", program);
+	fprintf(stderr, "\t-s frame\tFirst frame to render. Default: 0\n");
+	fprintf(stderr, "\t-n count\tNumber of frames to render. Default: all\n");
+	fprintf(stderr, "\t-x scale\tPixel scale, 1 to 16. Default: 4\n");
+	fprintf(stderr, "\t-a file\tAlso render the audio to a WAV file\n");
+}
+
+int main(int argc, char **argv) {
+	uint32_t start_frame = 0;
+	uint32_t frame_limit = UINT32_MAX;
+	unsigned int scale = 4;
+	const char *wav_path = NULL;
+	int opt;
+	while((opt = getopt(argc, argv, "s:n:x:a:")) != -1) {
+		switch(opt) {
+			case 's':
+				start_frame = strtoul(optarg, NULL, 0);
+			break;
+			case 'n':
+				frame_limit = strtoul(optarg, NULL, 0);
+			break;
+			case 'x':
+				scale = strtoul(optarg, NULL, 0);
+			break;
+			case 'a':
+				wav_path = optarg;
+			break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+	if(optind+2 > argc || scale < 1 || scale > 16) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	struct chip8_capture_reader reader;
+	if(chip8_capture_reader_open(&reader, argv[optind])) {
+		fprintf(stderr, "Failed to open the capture: %s\n", argv[optind]);
+		return 1;
+	}
+	if(chip8_capture_reader_seek(&reader, start_frame)) {
+		fprintf(stderr, "Failed to seek to frame %u\n", start_frame);
+		return 1;
+	}
+	FILE *video = fopen(argv[optind+1], "wb");
+	if(video == NULL) {
+		fprintf(stderr, "Failed to open the file: %s\n", argv[optind+1]);
+		return 1;
+	}
+	fprintf(video, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 Cmono\n", CHIP8_DISPLAY_WIDTH*scale, CHIP8_DISPLAY_HEIGHT*scale, FRAME_RATE);
+	FILE *wav = NULL;
+	if(wav_path) {
+		wav = fopen(wav_path, "wb");
+		if(wav == NULL) {
+			fprintf(stderr, "Failed to open the file: %s\n", wav_path);
+			return 1;
+		}
+		write_wav_header(wav, 0); // Rewritten once the length is known
+	}
+
+	struct chip8_capture_frame frame;
+	uint32_t frame_count = 0;
+	double phase = 0;
+	int ret = 0;
+	while(frame_count < frame_limit && (ret = chip8_capture_reader_read(&reader, &frame)) == 1) {
+		write_video_frame(video, &frame, scale);
+		if(wav) {
+			write_audio_frame(wav, &frame, &phase);
+		}
+		frame_count++;
+	}
+	if(frame_count < frame_limit && ret < 0) {
+		fprintf(stderr, "The capture is corrupted after frame %u\n", start_frame+frame_count);
+	}
+	chip8_capture_reader_close(&reader);
+
+	int failed = fclose(video) != 0;
+	if(wav) {
+		fseek(wav, 0, SEEK_SET);
+		write_wav_header(wav, frame_count*WAV_SAMPLES_PER_FRAME);
+		failed |= fclose(wav) != 0;
+	}
+	if(failed) {
+		fprintf(stderr, "Failed to write the output\n");
+		return 1;
+	}
+	printf("%u frames rendered\n", frame_count);
+	return 0;
+}
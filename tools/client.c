@@ -0,0 +1,234 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Test client of chip8-server. Opens one or more sessions, reconstructs each display from the streamed deltas and
+// verifies it against the checksum sent along with every frame. Keys are pressed and released pseudo-randomly so
+// that the ROM has something to react to.
+//
+// Exits with 1 if any frame fails the check.
+
+#include "session.h"
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define KEY_CHANGE_INTERVAL_FRAMES (15U)
+
+struct connection {
+	int fd;
+	uint8_t done;
+	uint16_t key_held;
+	uint32_t random_state;
+	uint32_t last_frame;
+	uint32_t frames;
+	uint32_t skipped_frames;
+	uint32_t corrupted_frames;
+	uint32_t halt_requests;
+	uint8_t display[sizeof(((struct chip8_periph*)0)->display)];
+	uint8_t in[SESSION_MAX_MESSAGE_SIZE];
+	size_t in_size;
+};
+
+static uint32_t xorshift32(uint32_t *state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+static void connection_send_keys(struct connection *c) {
+	uint8_t message[SESSION_HEADER_SIZE+2];
+	message[0] = SESSION_MSG_KEYS;
+	session_put_u16(&message[1], 2);
+	session_put_u16(&message[SESSION_HEADER_SIZE], c->key_held);
+	if(send(c->fd, message, sizeof(message), MSG_NOSIGNAL) != sizeof(message)) {
+		c->done = 1;
+	}
+}
+
+static void connection_handle_frame(struct connection *c, const uint8_t *payload, size_t size) {
+	if(size < SESSION_FRAME_HEADER_SIZE) {
+		c->corrupted_frames++;
+		return;
+	}
+	uint32_t frame = session_get_u32(&payload[0]);
+	uint32_t checksum = session_get_u32(&payload[4]);
+	if(c->frames && frame != c->last_frame+1) {
+		c->skipped_frames += frame-c->last_frame-1;
+	}
+	c->last_frame = frame;
+	c->frames++;
+	if(chip8_delta_apply(c->display, &payload[SESSION_FRAME_HEADER_SIZE], size-SESSION_FRAME_HEADER_SIZE)
+		|| chip8_display_checksum(c->display) != checksum) {
+		c->corrupted_frames++;
+	}
+
+	if(c->frames % KEY_CHANGE_INTERVAL_FRAMES == 0) {
+		c->key_held ^= 1U << (xorshift32(&c->random_state) % 16);
+		connection_send_keys(c);
+	}
+}
+
+static void connection_receive(struct connection *c, uint32_t frame_limit) {
+	ssize_t received = recv(c->fd, &c->in[c->in_size], sizeof(c->in)-c->in_size, MSG_DONTWAIT);
+	if(received <= 0) {
+		if(received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+			c->done = 1;
+		}
+		return;
+	}
+	c->in_size += received;
+
+	size_t n = 0;
+	while(!c->done && c->in_size-n >= SESSION_HEADER_SIZE) {
+		uint8_t type = c->in[n];
+		size_t payload_size = session_get_u16(&c->in[n+1]);
+		if(SESSION_HEADER_SIZE+payload_size > sizeof(c->in)) {
+			c->corrupted_frames++;
+			c->done = 1;
+			break;
+		}
+		if(c->in_size-n < SESSION_HEADER_SIZE+payload_size) {
+			break;
+		}
+		const uint8_t *payload = &c->in[n+SESSION_HEADER_SIZE];
+		switch(type) {
+			case SESSION_MSG_FRAME:
+				connection_handle_frame(c, payload, payload_size);
+				if(c->frames >= frame_limit) {
+					c->done = 1;
+				}
+			break;
+			case SESSION_MSG_HALT:
+				c->halt_requests = payload_size == 4 ? session_get_u32(payload) : 0;
+				c->done = 1;
+			break;
+			default:
+				c->corrupted_frames++;
+				c->done = 1;
+			break;
+		}
+		n += SESSION_HEADER_SIZE+payload_size;
+	}
+	memmove(c->in, &c->in[n], c->in_size-n);
+	c->in_size -= n;
+}
+
+static void print_usage(const char *program) {
+	fprintf(stderr, "Usage: %s [options] <socket path>\n", program);
+	fprintf(stderr, "\t-n count\tNumber of sessions to open. Default: 1\n");
+	fprintf(stderr, "\t-f frames\tNumber of frames to receive per session. Default: 600\n");
+}
+
+int main(int argc, char **argv) {
+	size_t connection_count = 1;
+	uint32_t frame_limit = 600;
+	int opt;
+	while((opt = getopt(argc, argv, "n:f:")) != -1) {
+		switch(opt) {
+			case 'n':
+				connection_count = strtoul(optarg, NULL, 0);
+			break;
+			case 'f':
+				frame_limit = strtoul(optarg, NULL, 0);
+			break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+	if(optind >= argc || connection_count == 0) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if(strlen(argv[optind]) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path too long: %s\n", argv[optind]);
+		return 1;
+	}
+	strcpy(addr.sun_path, argv[optind]);
+
+	struct connection *connections = calloc(connection_count, sizeof(*connections));
+	struct pollfd *fds = calloc(connection_count, sizeof(*fds));
+	if(connections == NULL || fds == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	for(size_t n=0; n<connection_count; n++) {
+		connections[n].fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(connections[n].fd < 0 || connect(connections[n].fd, (struct sockaddr*)&addr, sizeof(addr))) {
+			perror("Failed to connect to the server");
+			return 1;
+		}
+		connections[n].random_state = n+1;
+	}
+
+	size_t remaining = connection_count;
+	while(remaining) {
+		for(size_t n=0; n<connection_count; n++) {
+			fds[n].fd = connections[n].done ? -1 : connections[n].fd;
+			fds[n].events = POLLIN;
+			fds[n].revents = 0;
+		}
+		if(poll(fds, connection_count, 1000) < 0 && errno != EINTR) {
+			perror("poll");
+			return 1;
+		}
+		remaining = 0;
+		for(size_t n=0; n<connection_count; n++) {
+			if(!connections[n].done && fds[n].revents) {
+				connection_receive(&connections[n], frame_limit);
+			}
+			remaining += !connections[n].done;
+		}
+	}
+
+	uint64_t frames = 0;
+	uint64_t skipped_frames = 0;
+	uint64_t corrupted_frames = 0;
+	size_t halted = 0;
+	for(size_t n=0; n<connection_count; n++) {
+		frames += connections[n].frames;
+		skipped_frames += connections[n].skipped_frames;
+		corrupted_frames += connections[n].corrupted_frames;
+		halted += !!connections[n].halt_requests;
+		close(connections[n].fd);
+	}
+	printf("%zu sessions, %llu frames received, %llu frames coalesced by the server, %zu halted, %llu corrupted\n",
+		connection_count, (unsigned long long)frames, (unsigned long long)skipped_frames, halted,
+		(unsigned long long)corrupted_frames);
+	return corrupted_frames ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Fuzz target of the CHIP-8 core.
+//
+// The fuzz input is loaded as-is to CHIP8_PROGRAM_START_OFFSET, so any crashing input saved by the fuzzer is a ROM
+// that can be loaded by the emulator directly. The last FUZZ_KEY_SCRIPT_SIZE bytes of the input double as the keypad
+// script: one 16bit little-endian key_held value per frame, repeated once the script runs out. The 2 bytes before it
+// are the quirks (16bit little-endian, masked to the implemented ones), so that the quirk-dependent paths are fuzzed
+// too. The replayer prints them, to be passed to the emulator with -q.
+//
+// Built with clang's libFuzzer (make fuzz), it's coverage-guided. Without CHIP8_FUZZ_LIBFUZZER, it's built as a
+// replayer (make tools) that runs the given ROMs exactly as the fuzzer did and prints how the machine ended up.
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FUZZ_FRAMES (8U)
+#define FUZZ_KEY_SCRIPT_FRAMES (16U)
+#define FUZZ_KEY_SCRIPT_SIZE (FUZZ_KEY_SCRIPT_FRAMES*2)
+#define FUZZ_QUIRKS_SIZE (2U)
+#define FUZZ_QUIRK_MASK ((CHIP8_QUIRK_RESIZE_CLEAR_SCREEN << 1) - 1) // CHIP8_QUIRK_VF_ORDER is unimplemented
+
+// Post-chip8_init() image. Restoring it is a plain copy, which is much cheaper than chip8_init() for every run
+static struct chip8_machine machine_template;
+static struct chip8_machine machine;
+
+static void fuzz_init(void) {
+	chip8_init(&machine_template, &chip8_cfg);
+}
+
+static void fuzz_run(const uint8_t *data, size_t size) {
+	machine = machine_template;
+	if(size > CHIP8_MEMORY_SIZE-CHIP8_PROGRAM_START_OFFSET) {
+		size = CHIP8_MEMORY_SIZE-CHIP8_PROGRAM_START_OFFSET;
+	}
+	memcpy(&machine.mem[CHIP8_PROGRAM_START_OFFSET], data, size);
+
+	const uint8_t *key_script = NULL;
+	if(size >= FUZZ_KEY_SCRIPT_SIZE) {
+		key_script = &data[size-FUZZ_KEY_SCRIPT_SIZE];
+	}
+	if(size >= FUZZ_KEY_SCRIPT_SIZE+FUZZ_QUIRKS_SIZE) {
+		const uint8_t *quirks = &data[size-FUZZ_KEY_SCRIPT_SIZE-FUZZ_QUIRKS_SIZE];
+		machine.cpu.quirks = (quirks[0] | (quirks[1] << 8)) & FUZZ_QUIRK_MASK;
+	}
+
+	for(size_t frame=0; frame<FUZZ_FRAMES; frame++) {
+		if(key_script) {
+			size_t k = frame % FUZZ_KEY_SCRIPT_FRAMES;
+			uint16_t key_held = key_script[k*2] | (key_script[k*2+1] << 8);
+			machine.periph.key_just_released = machine.periph.key_held & ~key_held;
+			machine.periph.key_held = key_held;
+		}
+		chip8_run_frame(&machine, CYCLE_PER_FRAME);
+		if(machine.periph.requests & CHIP8_REQUEST_HALT_MASK) {
+			return;
+		}
+	}
+}
+
+#ifdef CHIP8_FUZZ_LIBFUZZER
+
+int LLVMFuzzerInitialize(int *argc, char ***argv) {
+	(void)argc;
+	(void)argv;
+	fuzz_init();
+	return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	fuzz_run(data, size);
+	return 0;
+}
+
+#else
+
+int main(int argc, char **argv) {
+	if(argc < 2) {
+		fprintf(stderr, "Usage: %s <chip8rom.ch8>...\n", argv[0]);
+		return 1;
+	}
+	fuzz_init();
+
+	static uint8_t data[CHIP8_MEMORY_SIZE];
+	for(int n=1; n<argc; n++) {
+		FILE *fp = fopen(argv[n], "rb");
+		if(fp == NULL) {
+			fprintf(stderr, "Failed to open the file: %s\n", argv[n]);
+			return 1;
+		}
+		size_t size = fread(data, 1, sizeof(data), fp);
+		if(ferror(fp)) {
+			fprintf(stderr, "Failed to read the file's content: %s\n", argv[n]);
+			fclose(fp);
+			return 1;
+		}
+		fclose(fp);
+
+		fuzz_run(data, size);
+		printf("%s: quirks %03x, requests %08x, pc %04x, pc_index %u, i %04x\n", argv[n], machine.cpu.quirks,
+			machine.periph.requests, machine.cpu.pc[machine.cpu.pc_index], machine.cpu.pc_index, machine.cpu.i);
+	}
+	return 0;
+}
+
+#endif
@@ -0,0 +1,225 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Loopback test of the rollback link. Runs both players in one process over a socket pair, with the key sends
+// delayed by -d frames and the two sides taking turns unevenly. Each player presses and releases its keys
+// pseudo-randomly. Every snapshot that the link has confirmed is compared against a reference machine run
+// without the link, with both players' keys known in advance.
+//
+// Exits with 1 if any confirmed state differs from the reference.
+
+#include "config.h"
+#include "rollback.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define KEY_CHANGE_INTERVAL_FRAMES (15U)
+#define FRAME_BUDGET_US (16000U)
+
+struct player {
+	struct chip8_rollback link;
+	struct chip8_machine machine;
+	struct chip8_machine reference; // At the start of frame `checked`
+	uint32_t checked; // Snapshots of the frames before it have been checked
+	uint32_t mismatches;
+	uint32_t max_advance_us;
+};
+
+static uint32_t random_state = 1;
+static uint16_t *keys[2]; // Keys held by each player at each frame
+
+static uint32_t xorshift32(void) {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+static uint16_t script_held(uint32_t frame) {
+	return (keys[0][frame] & CHIP8_ROLLBACK_PLAYER1_KEYS) | (keys[1][frame] & CHIP8_ROLLBACK_PLAYER2_KEYS);
+}
+
+static uint16_t script_released(uint8_t player, uint32_t frame) {
+	return frame ? keys[player][frame-1] & ~keys[player][frame] : 0;
+}
+
+static int same_state(const struct chip8_machine *a, const struct chip8_machine *b) {
+	return !memcmp(a->mem, b->mem, sizeof(a->mem)) &&
+		!memcmp(a->periph.display, b->periph.display, sizeof(a->periph.display)) &&
+		!memcmp(a->cpu.v, b->cpu.v, sizeof(a->cpu.v)) &&
+		!memcmp(a->cpu.pc, b->cpu.pc, sizeof(a->cpu.pc)) &&
+		a->cpu.pc_index == b->cpu.pc_index && a->cpu.i == b->cpu.i &&
+		a->periph.delay_timer == b->periph.delay_timer && a->periph.sound_timer == b->periph.sound_timer &&
+		a->periph.random_state == b->periph.random_state && a->periph.requests == b->periph.requests;
+}
+
+static int advance(struct player *player, uint8_t index) {
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	uint32_t frame = player->link.frame;
+	int result = chip8_rollback_advance(&player->link, &player->machine, keys[index][frame], script_released(index, frame));
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	uint32_t us = (end.tv_sec-start.tv_sec)*1000000 + (end.tv_nsec-start.tv_nsec)/1000;
+	if(us > player->max_advance_us) {
+		player->max_advance_us = us;
+	}
+	if(result < 0) {
+		return -1;
+	}
+
+	// Snapshots up to the confirmed frame are final. The oldest ones in the window get overwritten by the newer frames.
+	const struct chip8_rollback *link = &player->link;
+	uint32_t oldest = link->frame > CHIP8_ROLLBACK_WINDOW ? link->frame-CHIP8_ROLLBACK_WINDOW : 0;
+	if(player->checked < oldest) {
+		fprintf(stderr, "Player %u: frame %u went out of the window before being confirmed\n", index+1, player->checked);
+		return -1;
+	}
+	while(player->checked <= link->confirmed && player->checked < link->frame) {
+		if(!same_state(&link->snapshots[player->checked % CHIP8_ROLLBACK_WINDOW], &player->reference)) {
+			if(!player->mismatches) {
+				fprintf(stderr, "Player %u: frame %u differs from the reference\n", index+1, player->checked);
+			}
+			player->mismatches++;
+		}
+		player->reference.periph.key_held = script_held(player->checked);
+		player->reference.periph.key_just_released = script_released(0, player->checked) & CHIP8_ROLLBACK_PLAYER1_KEYS;
+		player->reference.periph.key_just_released |= script_released(1, player->checked) & CHIP8_ROLLBACK_PLAYER2_KEYS;
+		chip8_run_frame(&player->reference, CYCLE_PER_FRAME);
+		player->checked++;
+	}
+	return 0;
+}
+
+static void print_usage(const char *program) {
+	fprintf(stderr, "Usage: %s [options] <chip8rom.ch8>\n", program);
+	fprintf(stderr, "\t-d delay\tFrames to delay the key sends by, up to %u. Default: 3\n", CHIP8_ROLLBACK_WINDOW/2);
+	fprintf(stderr, "\t-f frames\tNumber of frames to check. Default: 3600\n");
+}
+
+int main(int argc, char **argv) {
+	uint32_t delay = 3;
+	uint32_t frames = 3600;
+	int opt;
+	while((opt = getopt(argc, argv, "d:f:")) != -1) {
+		switch(opt) {
+			case 'd':
+				delay = strtoul(optarg, NULL, 0);
+			break;
+			case 'f':
+				frames = strtoul(optarg, NULL, 0);
+			break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+	if(optind >= argc || delay > CHIP8_ROLLBACK_WINDOW/2) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	static struct chip8_machine machine;
+	chip8_init(&machine, &chip8_cfg);
+	FILE *fp = fopen(argv[optind], "rb");
+	if(fp == NULL) {
+		fprintf(stderr, "Failed to open the file: %s\n", argv[optind]);
+		return 1;
+	}
+	fread(&machine.mem[CHIP8_PROGRAM_START_OFFSET], 1, CHIP8_MEMORY_SIZE-CHIP8_PROGRAM_START_OFFSET, fp);
+	if(ferror(fp)) {
+		fprintf(stderr, "Failed to read the file's content: %s\n", argv[optind]);
+		return 1;
+	}
+	fclose(fp);
+
+	// The players keep running past the checked frames until every checked frame is confirmed on both sides
+	uint32_t script_size = frames + 4*CHIP8_ROLLBACK_WINDOW;
+	keys[0] = calloc(script_size, sizeof(uint16_t));
+	keys[1] = calloc(script_size, sizeof(uint16_t));
+	static struct player players[2];
+	int fds[2];
+	if(keys[0] == NULL || keys[1] == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+		perror("socketpair");
+		return 1;
+	}
+	for(uint8_t p=0; p<2; p++) {
+		uint16_t held = 0;
+		for(uint32_t frame=0; frame<frames; frame++) {
+			if(frame % KEY_CHANGE_INTERVAL_FRAMES == 0) {
+				held = xorshift32() & (p ? CHIP8_ROLLBACK_PLAYER2_KEYS : CHIP8_ROLLBACK_PLAYER1_KEYS) & xorshift32();
+			}
+			keys[p][frame] = held;
+		}
+		players[p].machine = machine;
+		players[p].reference = machine;
+		chip8_rollback_init(&players[p].link, fds[p], p+1, CYCLE_PER_FRAME, delay, &machine);
+	}
+
+	// The sides take turns unevenly, so that either one gets ahead of the other at times
+	while(players[0].checked < frames || players[1].checked < frames) {
+		for(uint8_t p=0; p<2; p++) {
+			uint32_t turns = 1 + (xorshift32() % 4 == 0);
+			for(uint32_t n=0; n<turns; n++) {
+				if(players[p].link.frame >= script_size) {
+					fprintf(stderr, "Player %u: the checked frames haven't been confirmed in time\n", p+1);
+					return 1;
+				}
+				if(advance(&players[p], p)) {
+					fprintf(stderr, "Player %u: the link is broken\n", p+1);
+					return 1;
+				}
+			}
+		}
+	}
+
+	int failed = 0;
+	for(uint8_t p=0; p<2; p++) {
+		const struct chip8_rollback *link = &players[p].link;
+		printf("player %u:\t%u frames checked, %u mismatched, %u rollbacks, %u frames re-simulated (max %u at once), %u stalls, max %u us per frame\n",
+			p+1, players[p].checked, players[p].mismatches, link->rollbacks, link->frames_resimulated, link->max_rollback_frames,
+			link->stalls, players[p].max_advance_us);
+		if(players[p].mismatches) {
+			failed = 1;
+		}
+		if(players[p].max_advance_us > FRAME_BUDGET_US) {
+			printf("player %u:\tover the frame budget of %u us\n", p+1, FRAME_BUDGET_US);
+		}
+		chip8_rollback_close(&players[p].link);
+	}
+	free(keys[0]);
+	free(keys[1]);
+	return failed;
+}
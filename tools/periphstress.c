@@ -0,0 +1,160 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Stress test of the concurrency contract of struct chip8_periph. One thread runs chip8_step() on a ROM that keeps
+// storing into the timers, publishing audio patterns and pitches, and waiting for keys. Another thread plays the
+// interrupts: it steps the timers, scans random keys in, clears the VBLANK wait and reads the audio latch.
+// Build it with `make tsan` to run it under ThreadSanitizer.
+//
+// Exits with 1 if a timer wraps around or a torn audio pattern is read.
+
+#include "config.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_TIMER_VALUE (60U)
+
+// Counts V0 from 0 to MAX_TIMER_VALUE. For each value, it's stored into both timers and the pitch, and into the top
+// byte of each word of the audio pattern. FX0A waits for a release edge from the interrupt thread.
+static const uint8_t rom[] = {
+	0x60, 0x00, // 200: LD V0, 0
+	0xF0, 0x15, // 202: LD DT, V0
+	0xF0, 0x18, // 204: LD ST, V0
+	0xF0, 0x3A, // 206: PITCH V0
+	0xA3, 0x00, // 208: LD I, 0x300
+	0xF0, 0x55, // 20A: LD [I], V0
+	0xA3, 0x04, // 20C: LD I, 0x304
+	0xF0, 0x55, // 20E: LD [I], V0
+	0xA3, 0x08, // 210: LD I, 0x308
+	0xF0, 0x55, // 212: LD [I], V0
+	0xA3, 0x0C, // 214: LD I, 0x30C
+	0xF0, 0x55, // 216: LD [I], V0
+	0xA3, 0x00, // 218: LD I, 0x300
+	0xF0, 0x02, // 21A: AUDIO
+	0xF1, 0x07, // 21C: LD V1, DT
+	0xE0, 0x9E, // 21E: SKP V0
+	0xF2, 0x0A, // 220: LD V2, K
+	0x70, 0x01, // 222: ADD V0, 1
+	0x30, MAX_TIMER_VALUE+1, // 224: SE V0, MAX_TIMER_VALUE+1
+	0x12, 0x02, // 226: JP 0x202
+	0x12, 0x00, // 228: JP 0x200
+};
+
+static struct chip8_machine machine;
+static atomic_int done;
+
+static void *step_thread(void *arg) {
+	uint32_t steps = *(uint32_t*)arg;
+	for(uint32_t n=0; n<steps; n++) {
+		chip8_step(&machine);
+	}
+	atomic_store(&done, 1);
+	return NULL;
+}
+
+static uint32_t xorshift32(uint32_t *state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+static void print_usage(const char *program) {
+	fprintf(stderr, "Usage: %s [options]\n", program);
+	fprintf(stderr, "\t-n steps\tNumber of instructions to run. Default: 10000000\n");
+}
+
+int main(int argc, char **argv) {
+	uint32_t steps = 10000000;
+	int opt;
+	while((opt = getopt(argc, argv, "n:")) != -1) {
+		switch(opt) {
+			case 'n':
+				steps = strtoul(optarg, NULL, 0);
+			break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	chip8_init(&machine, &chip8_cfg);
+	machine.cpu.quirks = CHIP8_QUIRK_PLATFORM_XOCHIP;
+	memcpy(&machine.mem[CHIP8_PROGRAM_START_OFFSET], rom, sizeof(rom));
+
+	pthread_t thread;
+	if(pthread_create(&thread, NULL, step_thread, &steps)) {
+		fprintf(stderr, "Failed to create the thread\n");
+		return 1;
+	}
+
+	uint32_t random_state = 1;
+	uint64_t interrupts = 0;
+	uint32_t wrapped_timers = 0;
+	uint32_t torn_patterns = 0;
+	uint32_t patterns_seen = 0;
+	uint8_t last_pitch = 0;
+	while(!atomic_load(&done)) {
+		chip8_timer_step(&machine);
+		if(machine.periph.delay_timer > MAX_TIMER_VALUE || machine.periph.sound_timer > MAX_TIMER_VALUE) {
+			wrapped_timers++;
+		}
+
+		uint32_t keys = xorshift32(&random_state);
+		machine.periph.key_held = keys;
+		atomic_fetch_or(&machine.periph.key_just_released, (uint16_t)(keys >> 16));
+		machine.periph.requests &= ~CHIP8_REQUEST_WAIT_DISPLAY_REFRESH;
+
+		uint32_t audio[CHIP8_AUDIO_BUFFER_SIZE/4];
+		uint8_t audio_pitch;
+		chip8_audio_read(&machine.periph, audio, &audio_pitch);
+		for(size_t n=1; n<CHIP8_AUDIO_BUFFER_SIZE/4; n++) {
+			if((audio[n] >> 24) != (audio[0] >> 24)) {
+				torn_patterns++;
+				break;
+			}
+		}
+		if(audio_pitch != last_pitch) {
+			patterns_seen++;
+			last_pitch = audio_pitch;
+		}
+		interrupts++;
+	}
+	pthread_join(thread, NULL);
+
+	if(machine.periph.requests & CHIP8_REQUEST_HALT_MASK) {
+		fprintf(stderr, "The machine halted: %08x\n", machine.periph.requests);
+		return 1;
+	}
+	printf("%u steps, %llu interrupts, %u pitch changes seen, %u wrapped timers, %u torn audio patterns\n",
+		steps, (unsigned long long)interrupts, patterns_seen, wrapped_timers, torn_patterns);
+	return wrapped_timers || torn_patterns;
+}
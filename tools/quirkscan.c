@@ -0,0 +1,286 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Finds the quirks that a ROM expects by running it headlessly under every combination of the implemented quirks,
+// spread across threads, and scoring how well each run went. The recommended quirks can be stored into the quirk
+// database, so that the emulator boots the ROM with them.
+//
+// Scoring: a run that halts on an error is ranked by how long it survived, and always below a run that didn't.
+// Among the runs that survived, the ones with more display activity rank higher. Many combinations usually end up
+// with identical results because the ROM never runs the affected instructions. In that case, the combination
+// closest to one of the platform presets wins.
+
+#include "config.h"
+#include "quirkdb.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define QUIRK_BITS (12U) // CHIP8_QUIRK_VF_ORDER is unimplemented, so it's left out
+#define DEFAULT_FRAMES (3000U)
+#define MAX_THREADS (64U)
+#define KEY_HOLD_FRAMES (30U) // Keys are pressed in turn for this long, then released for as long
+
+// Halting on an error weighs more than any amount of display activity
+#define SCORE_SURVIVED_FRAME (1000)
+#define SCORE_ERROR_HALT (-1000000)
+#define SCORE_CHANGED_FRAME (1)
+
+static const uint32_t platforms[] = {CHIP8_QUIRK_PLATFORM_VIP, CHIP8_QUIRK_PLATFORM_SCHIP, CHIP8_QUIRK_PLATFORM_XOCHIP};
+static const char *platform_names[] = {"VIP", "SCHIP", "XOCHIP"};
+
+struct result {
+	uint32_t quirks;
+	int64_t score;
+	uint32_t requests;
+	uint32_t frames_run;
+	uint32_t changed_frames;
+	uint8_t platform_distance;
+};
+
+static struct chip8_machine machine_template;
+static uint32_t frame_limit = DEFAULT_FRAMES;
+static uint32_t cycles_per_frame; // -i, else the quirk database, else CYCLE_PER_FRAME. Same as the emulator.
+static uint32_t *candidates;
+static struct result *results;
+static size_t candidate_count;
+static atomic_size_t next_candidate;
+
+static uint8_t popcount(uint32_t value) {
+	uint8_t count = 0;
+	for(; value; value &= value-1) {
+		count++;
+	}
+	return count;
+}
+
+static void run_candidate(struct result *result, uint32_t quirks) {
+	static _Thread_local struct chip8_machine machine;
+	static _Thread_local uint8_t previous_display[sizeof(machine.periph.display)];
+	machine = machine_template;
+	machine.cpu.quirks = quirks;
+	memset(previous_display, 0, sizeof(previous_display));
+
+	memset(result, 0, sizeof(*result));
+	result->quirks = quirks;
+	uint32_t frame;
+	for(frame=0; frame<frame_limit; frame++) {
+		uint16_t key_held = ((frame/KEY_HOLD_FRAMES) % 2) ? 1U << ((frame/KEY_HOLD_FRAMES/2) % 16) : 0;
+		machine.periph.key_just_released = machine.periph.key_held & ~key_held;
+		machine.periph.key_held = key_held;
+		chip8_run_frame(&machine, cycles_per_frame);
+		if(machine.periph.requests & CHIP8_REQUEST_HALT_MASK) {
+			break;
+		}
+		if(memcmp(previous_display, machine.periph.display, sizeof(previous_display))) {
+			memcpy(previous_display, machine.periph.display, sizeof(previous_display));
+			result->changed_frames++;
+		}
+	}
+	result->frames_run = frame;
+	result->requests = machine.periph.requests;
+	result->score = (int64_t)frame*SCORE_SURVIVED_FRAME + (int64_t)result->changed_frames*SCORE_CHANGED_FRAME;
+	if(machine.periph.requests & CHIP8_REQUEST_HALT_MASK & ~CHIP8_REQUEST_HALT_EXIT_EMULATOR) {
+		result->score += SCORE_ERROR_HALT;
+	}
+	result->platform_distance = QUIRK_BITS;
+	for(size_t n=0; n<sizeof(platforms)/sizeof(platforms[0]); n++) {
+		uint8_t distance = popcount(quirks ^ platforms[n]);
+		if(distance < result->platform_distance) {
+			result->platform_distance = distance;
+		}
+	}
+}
+
+static void *worker(void *arg) {
+	(void)arg;
+	size_t n;
+	while((n = atomic_fetch_add(&next_candidate, 1)) < candidate_count) {
+		run_candidate(&results[n], candidates[n]);
+	}
+	return NULL;
+}
+
+// Best first
+static int compare_results(const void *a, const void *b) {
+	const struct result *ra = a;
+	const struct result *rb = b;
+	if(ra->score != rb->score) {
+		return ra->score > rb->score ? -1 : 1;
+	}
+	if(ra->platform_distance != rb->platform_distance) {
+		return ra->platform_distance < rb->platform_distance ? -1 : 1;
+	}
+	if(popcount(ra->quirks) != popcount(rb->quirks)) {
+		return popcount(ra->quirks) < popcount(rb->quirks) ? -1 : 1;
+	}
+	return ra->quirks < rb->quirks ? -1 : (ra->quirks > rb->quirks);
+}
+
+static void print_usage(const char *program) {
+	fprintf(stderr, "Usage: %s [options] <chip8rom.ch8>\n", program);
+	fprintf(stderr, "\t-f frames\tFrames to run per combination. Default: %u\n", DEFAULT_FRAMES);
+	fprintf(stderr, "\t-j threads\tDefault: number of online CPUs\n");
+	fprintf(stderr, "\t-i cycles\tInstructions per frame. Default: from the quirk database, else %u\n", CYCLE_PER_FRAME);
+	fprintf(stderr, "\t-w\tStore the recommended quirks into the quirk database, along with -i if given\n");
+	fprintf(stderr, "\t-d file\tQuirk database. Default: $CHIP8_QUIRK_DB, or $HOME/.chip8-quirks.db\n");
+}
+
+int main(int argc, char **argv) {
+	long thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+	uint8_t store = 0;
+	const char *db_path = chip8_quirkdb_default_path();
+	int opt;
+	while((opt = getopt(argc, argv, "f:j:i:wd:")) != -1) {
+		switch(opt) {
+			case 'f':
+				frame_limit = strtoul(optarg, NULL, 0);
+			break;
+			case 'j':
+				thread_count = strtol(optarg, NULL, 0);
+			break;
+			case 'i':
+				cycles_per_frame = strtoul(optarg, NULL, 0);
+				if(!cycles_per_frame) {
+					print_usage(argv[0]);
+					return 1;
+				}
+			break;
+			case 'w':
+				store = 1;
+			break;
+			case 'd':
+				db_path = optarg;
+			break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+	if(optind >= argc) {
+		print_usage(argv[0]);
+		return 1;
+	}
+	if(thread_count < 1) {
+		thread_count = 1;
+	} else if(thread_count > MAX_THREADS) {
+		thread_count = MAX_THREADS;
+	}
+
+	static uint8_t rom[CHIP8_MEMORY_SIZE-CHIP8_PROGRAM_START_OFFSET];
+	FILE *fp = fopen(argv[optind], "rb");
+	if(fp == NULL) {
+		fprintf(stderr, "Failed to open the file: %s\n", argv[optind]);
+		return 1;
+	}
+	size_t rom_size = fread(rom, 1, sizeof(rom), fp);
+	if(ferror(fp)) {
+		fprintf(stderr, "Failed to read the file's content: %s\n", argv[optind]);
+		return 1;
+	}
+	fclose(fp);
+	uint64_t hash = chip8_quirkdb_hash(rom, rom_size);
+
+	// The quirks are scored at the instructions per frame that the emulator will run the ROM at
+	uint32_t db_quirks;
+	uint32_t db_cycles;
+	if(!cycles_per_frame && db_path && chip8_quirkdb_lookup(db_path, hash, &db_quirks, &db_cycles)) {
+		cycles_per_frame = db_cycles;
+	}
+	uint32_t stored_cycles = cycles_per_frame; // 0 leaves the entry without instructions per frame
+	if(!cycles_per_frame) {
+		cycles_per_frame = CYCLE_PER_FRAME;
+	}
+	chip8_init(&machine_template, &chip8_cfg);
+	memcpy(&machine_template.mem[CHIP8_PROGRAM_START_OFFSET], rom, rom_size);
+
+	candidates = calloc(1U << QUIRK_BITS, sizeof(*candidates));
+	results = calloc(1U << QUIRK_BITS, sizeof(*results));
+	if(candidates == NULL || results == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	for(uint32_t quirks=0; quirks<(1U << QUIRK_BITS); quirks++) {
+		// Skip the combinations that behave the same as another one, as one quirk takes precedence over the other
+		if((quirks & CHIP8_QUIRK_MEMORY_LEAVE_I_UNCHANGED) && (quirks & CHIP8_QUIRK_MEMORY_INCREASE_BY_X)) {
+			continue;
+		}
+		if((quirks & CHIP8_QUIRK_LORES_TALL_SPRITE) && (quirks & CHIP8_QUIRK_LORES_WIDE_SPRITE)) {
+			continue;
+		}
+		candidates[candidate_count++] = quirks;
+	}
+
+	pthread_t threads[MAX_THREADS];
+	for(long n=0; n<thread_count; n++) {
+		if(pthread_create(&threads[n], NULL, worker, NULL)) {
+			fprintf(stderr, "Failed to create threads\n");
+			return 1;
+		}
+	}
+	for(long n=0; n<thread_count; n++) {
+		pthread_join(threads[n], NULL);
+	}
+
+	qsort(results, candidate_count, sizeof(*results), compare_results);
+	size_t tied = 1;
+	while(tied < candidate_count && results[tied].score == results[0].score) {
+		tied++;
+	}
+	printf("%zu combinations, %u frames each at %u instructions per frame, %ld threads\n", candidate_count, frame_limit, cycles_per_frame, thread_count);
+	printf("Best runs:\n");
+	for(size_t n=0; n<candidate_count && n<5; n++) {
+		printf("\tquirks %03x: score %lld, %u frames run, %u frames changed the display, requests %08x\n",
+			results[n].quirks, (long long)results[n].score, results[n].frames_run, results[n].changed_frames, results[n].requests);
+	}
+	for(size_t n=0; n<sizeof(platforms)/sizeof(platforms[0]); n++) {
+		for(size_t r=0; r<candidate_count; r++) {
+			if(results[r].quirks == platforms[n]) {
+				printf("Platform %s (%03x): rank %zu, score %lld\n", platform_names[n], platforms[n], r+1, (long long)results[r].score);
+			}
+		}
+	}
+	uint32_t recommended = results[0].quirks;
+	printf("%zu combinations tied for the best score\n", tied);
+	printf("Recommended quirks: %03x\n", recommended);
+	if(results[0].requests & CHIP8_REQUEST_HALT_MASK & ~CHIP8_REQUEST_HALT_EXIT_EMULATOR) {
+		printf("Warning: the ROM halts under every combination of quirks\n");
+	}
+
+	if(store) {
+		if(db_path == NULL || chip8_quirkdb_store(db_path, hash, recommended, stored_cycles)) {
+			fprintf(stderr, "Failed to store into the quirk database: %s\n", db_path ? db_path : "(no path)");
+			return 1;
+		}
+		printf("Stored into %s\n", db_path);
+	}
+	return 0;
+}
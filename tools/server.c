@@ -0,0 +1,406 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Session server: runs a CHIP-8 machine per client connected to a Unix domain socket and streams its display as
+// per-frame deltas. See session.h for the protocol.
+//
+// Everything runs on a single thread. Sessions are cheap: a machine, the display the client has, and two buffers.
+// A client that can't keep up gets its frames coalesced rather than buffered, so it never slows the others down.
+
+#define _GNU_SOURCE // accept4()
+
+#include "config.h"
+#include "quirkdb.h"
+#include "session.h"
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NS_PER_SECOND (1000000000ULL)
+#define FRAME_RATE (60U)
+#define MAX_LAG_FRAMES (6U) // Beyond this, the server gives up catching up and restarts the frame schedule
+#define STATS_INTERVAL_FRAMES (FRAME_RATE*10)
+#define DEFAULT_MAX_SESSIONS (1024U)
+
+struct session {
+	int fd;
+	uint8_t closing; // Close once the output is flushed
+	uint8_t halted; // The machine has halted. SESSION_MSG_HALT is queued as soon as the output has room for it.
+	uint16_t key_released; // Release edges received since the last frame
+	uint32_t frame;
+	struct chip8_machine machine;
+	uint8_t sent_display[sizeof(((struct chip8_periph*)0)->display)]; // The display that the client has
+	uint8_t in[SESSION_MAX_MESSAGE_SIZE];
+	size_t in_size;
+	uint8_t out[SESSION_MAX_MESSAGE_SIZE];
+	size_t out_size;
+};
+
+static struct chip8_machine machine_template;
+static struct session **sessions;
+static size_t session_count;
+static size_t max_sessions = DEFAULT_MAX_SESSIONS;
+static uint32_t cycles_per_frame; // -i, else the quirk database, else CYCLE_PER_FRAME
+
+static struct {
+	uint64_t frames;
+	uint64_t work_ns;
+	uint64_t session_frames;
+	uint64_t coalesced_frames;
+} stats;
+
+static uint64_t monotonic_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*NS_PER_SECOND + ts.tv_nsec;
+}
+
+static void session_flush(struct session *s) {
+	while(s->out_size) {
+		ssize_t sent = send(s->fd, s->out, s->out_size, MSG_NOSIGNAL|MSG_DONTWAIT);
+		if(sent < 0) {
+			if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				// The client is gone. Drop whatever is left.
+				s->out_size = 0;
+				s->closing = 1;
+			}
+			return;
+		}
+		memmove(s->out, &s->out[sent], s->out_size-sent);
+		s->out_size -= sent;
+	}
+}
+
+// Returns a pointer to the payload to be filled
+static uint8_t *session_queue(struct session *s, uint8_t type, size_t payload_size) {
+	if(s->out_size+SESSION_HEADER_SIZE+payload_size > sizeof(s->out)) {
+		return NULL;
+	}
+	uint8_t *message = &s->out[s->out_size];
+	message[0] = type;
+	session_put_u16(&message[1], payload_size);
+	s->out_size += SESSION_HEADER_SIZE+payload_size;
+	return &message[SESSION_HEADER_SIZE];
+}
+
+// Queues SESSION_MSG_HALT, then closes the session once it's flushed. Retried as the output drains if it's full,
+// as the client would otherwise wait on a halted machine forever.
+static void session_send_halt(struct session *s) {
+	uint8_t *payload = session_queue(s, SESSION_MSG_HALT, 4);
+	if(payload == NULL) {
+		return;
+	}
+	session_put_u32(payload, s->machine.periph.requests);
+	s->closing = 1;
+	session_flush(s);
+}
+
+static void session_run_frame(struct session *s) {
+	struct chip8_periph *periph = &s->machine.periph;
+	periph->key_just_released = s->key_released;
+	s->key_released = 0;
+	chip8_run_frame(&s->machine, cycles_per_frame);
+	s->frame++;
+	stats.session_frames++;
+
+	if(periph->requests & CHIP8_REQUEST_HALT_MASK) {
+		s->halted = 1;
+		session_send_halt(s);
+		return;
+	}
+	if(s->out_size) {
+		// The client is still receiving an older frame. This frame would be included in the next delta.
+		stats.coalesced_frames++;
+		return;
+	}
+
+	static uint8_t delta[CHIP8_DELTA_MAX_SIZE];
+	size_t delta_size = chip8_delta_encode(s->sent_display, periph->display, delta);
+	uint8_t *payload = session_queue(s, SESSION_MSG_FRAME, SESSION_FRAME_HEADER_SIZE+delta_size);
+	session_put_u32(&payload[0], s->frame);
+	session_put_u32(&payload[4], chip8_display_checksum(periph->display));
+	payload[8] = periph->high_res;
+	payload[9] = periph->sound_timer > 0;
+	memcpy(&payload[SESSION_FRAME_HEADER_SIZE], delta, delta_size);
+	memcpy(s->sent_display, periph->display, sizeof(s->sent_display));
+	session_flush(s);
+}
+
+// Returns -1 if the session should be closed
+static int session_receive(struct session *s) {
+	ssize_t received = recv(s->fd, &s->in[s->in_size], sizeof(s->in)-s->in_size, MSG_DONTWAIT);
+	if(received == 0) {
+		return -1;
+	}
+	if(received < 0) {
+		return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+	}
+	s->in_size += received;
+
+	size_t n = 0;
+	while(s->in_size-n >= SESSION_HEADER_SIZE) {
+		uint8_t type = s->in[n];
+		size_t payload_size = session_get_u16(&s->in[n+1]);
+		if(payload_size > sizeof(s->in)-SESSION_HEADER_SIZE) {
+			return -1;
+		}
+		if(s->in_size-n < SESSION_HEADER_SIZE+payload_size) {
+			break;
+		}
+		const uint8_t *payload = &s->in[n+SESSION_HEADER_SIZE];
+		switch(type) {
+			case SESSION_MSG_KEYS:
+			{
+				if(payload_size != 2) {
+					return -1;
+				}
+				uint16_t key_held = session_get_u16(payload);
+				s->key_released |= s->machine.periph.key_held & ~key_held;
+				s->machine.periph.key_held = key_held;
+			}
+			break;
+			default:
+				return -1;
+		}
+		n += SESSION_HEADER_SIZE+payload_size;
+	}
+	memmove(s->in, &s->in[n], s->in_size-n);
+	s->in_size -= n;
+	return 0;
+}
+
+static void session_open(int fd) {
+	if(session_count >= max_sessions) {
+		fprintf(stderr, "Too many sessions. Refusing the new one.\n");
+		close(fd);
+		return;
+	}
+	struct session *s = calloc(1, sizeof(*s));
+	if(s == NULL) {
+		close(fd);
+		return;
+	}
+	s->fd = fd;
+	s->machine = machine_template;
+	static uint32_t session_id;
+	s->machine.periph.random_state ^= (++session_id) * 2654435761U;
+	if(!s->machine.periph.random_state) {
+		s->machine.periph.random_state = 1;
+	}
+	sessions[session_count++] = s;
+}
+
+static void session_close(size_t index) {
+	close(sessions[index]->fd);
+	free(sessions[index]);
+	sessions[index] = sessions[--session_count];
+}
+
+// Quirks and instructions per frame are picked the same way as the emulator does: -q and -i, else the quirk database
+// filled by chip8-quirkscan, else the default config. Otherwise, a session would play a different game than the
+// emulator does locally.
+static int load_rom(const char *path, const uint32_t *quirks) {
+	chip8_init(&machine_template, &chip8_cfg);
+	machine_template.periph.random_state = time(NULL) | 1;
+	FILE *fp = fopen(path, "rb");
+	if(fp == NULL) {
+		fprintf(stderr, "Failed to open the file: %s\n", path);
+		return -1;
+	}
+	size_t rom_size = fread(&machine_template.mem[CHIP8_PROGRAM_START_OFFSET], 1, CHIP8_MEMORY_SIZE-CHIP8_PROGRAM_START_OFFSET, fp);
+	if(ferror(fp)) {
+		fprintf(stderr, "Failed to read the file's content: %s\n", path);
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+
+	const char *quirk_db_path = chip8_quirkdb_default_path();
+	uint32_t db_quirks;
+	uint32_t db_cycles;
+	if(quirk_db_path && chip8_quirkdb_lookup(quirk_db_path, chip8_quirkdb_hash(&machine_template.mem[CHIP8_PROGRAM_START_OFFSET], rom_size), &db_quirks, &db_cycles)) {
+		if(!quirks) {
+			machine_template.cpu.quirks = db_quirks;
+			printf("Quirks from %s\n", quirk_db_path);
+		}
+		if(!cycles_per_frame && db_cycles) {
+			cycles_per_frame = db_cycles;
+			printf("Instructions per frame from %s\n", quirk_db_path);
+		}
+	}
+	if(quirks) {
+		machine_template.cpu.quirks = *quirks;
+	}
+	if(!cycles_per_frame) {
+		cycles_per_frame = CYCLE_PER_FRAME;
+	}
+	printf("Quirks: %03x, instructions per frame: %u\n", machine_template.cpu.quirks, cycles_per_frame);
+	return 0;
+}
+
+static void print_usage(const char *program) {
+	fprintf(stderr, "Usage: %s [options] <socket path> <chip8rom.ch8>\n", program);
+	fprintf(stderr, "\t-n count\tMaximum number of concurrent sessions. Default: %u\n", DEFAULT_MAX_SESSIONS);
+	fprintf(stderr, "\t-q quirks\tCHIP8_QUIRK_* mask in hex. Default: from the quirk database ($CHIP8_QUIRK_DB or $HOME/.chip8-quirks.db), else %03x\n", chip8_cfg.quirks);
+	fprintf(stderr, "\t-i cycles\tInstructions per frame. Default: from the quirk database, else %u\n", CYCLE_PER_FRAME);
+}
+
+int main(int argc, char **argv) {
+	int opt;
+	uint32_t quirks = 0;
+	uint8_t quirks_overridden = 0;
+	while((opt = getopt(argc, argv, "n:q:i:")) != -1) {
+		switch(opt) {
+			case 'n':
+				max_sessions = strtoul(optarg, NULL, 0);
+			break;
+			case 'q':
+				quirks = strtoul(optarg, NULL, 16);
+				quirks_overridden = 1;
+			break;
+			case 'i':
+				cycles_per_frame = strtoul(optarg, NULL, 0);
+				if(!cycles_per_frame) {
+					print_usage(argv[0]);
+					return 1;
+				}
+			break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+	if(optind+2 > argc || max_sessions == 0) {
+		print_usage(argv[0]);
+		return 1;
+	}
+	const char *socket_path = argv[optind];
+	if(load_rom(argv[optind+1], quirks_overridden ? &quirks : NULL)) {
+		return 1;
+	}
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if(strlen(socket_path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path too long: %s\n", socket_path);
+		return 1;
+	}
+	strcpy(addr.sun_path, socket_path);
+	int listen_fd = socket(AF_UNIX, SOCK_STREAM|SOCK_NONBLOCK, 0);
+	unlink(socket_path);
+	if(listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) || listen(listen_fd, SOMAXCONN)) {
+		perror("Failed to listen on the socket");
+		return 1;
+	}
+
+	sessions = calloc(max_sessions, sizeof(*sessions));
+	struct pollfd *fds = calloc(max_sessions+1, sizeof(*fds));
+	if(sessions == NULL || fds == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	uint64_t schedule_start = monotonic_ns();
+	uint64_t schedule_frame = 0;
+	while(1) {
+		uint64_t now = monotonic_ns();
+		uint64_t next_frame_ns = schedule_start + (schedule_frame+1)*NS_PER_SECOND/FRAME_RATE;
+		if(now >= next_frame_ns) {
+			for(size_t n=0; n<session_count; n++) {
+				if(!sessions[n]->closing && !sessions[n]->halted) {
+					session_run_frame(sessions[n]);
+				}
+			}
+			uint64_t done = monotonic_ns();
+			stats.work_ns += done-now;
+			stats.frames++;
+			schedule_frame++;
+			if(done > next_frame_ns + MAX_LAG_FRAMES*NS_PER_SECOND/FRAME_RATE) {
+				fprintf(stderr, "Lagging behind. Restarting the frame schedule.\n");
+				schedule_start = done;
+				schedule_frame = 0;
+			}
+			if(stats.frames % STATS_INTERVAL_FRAMES == 0) {
+				printf("sessions %zu, %.1f us per frame, %.2f us per session frame, %llu frames coalesced\n",
+					session_count, stats.work_ns/1000.0/stats.frames,
+					stats.session_frames ? stats.work_ns/1000.0/stats.session_frames : 0.0,
+					(unsigned long long)stats.coalesced_frames);
+				fflush(stdout);
+				memset(&stats, 0, sizeof(stats));
+			}
+			continue;
+		}
+
+		fds[0].fd = listen_fd;
+		fds[0].events = POLLIN;
+		for(size_t n=0; n<session_count; n++) {
+			fds[n+1].fd = sessions[n]->fd;
+			fds[n+1].events = POLLIN | (sessions[n]->out_size ? POLLOUT : 0);
+			fds[n+1].revents = 0;
+		}
+		int timeout_ms = (next_frame_ns-now+999999)/1000000;
+		size_t polled_count = session_count;
+		if(poll(fds, polled_count+1, timeout_ms) < 0 && errno != EINTR) {
+			perror("poll");
+			return 1;
+		}
+
+		// Iterates backward as session_close() moves the last session into the closed one's place
+		for(size_t n=polled_count; n>0; n--) {
+			struct session *s = sessions[n-1];
+			if(fds[n].revents & (POLLIN|POLLHUP|POLLERR)) {
+				if(session_receive(s)) {
+					session_close(n-1);
+					continue;
+				}
+			}
+			if(fds[n].revents & POLLOUT) {
+				session_flush(s);
+				if(s->halted && !s->closing) {
+					session_send_halt(s);
+				}
+			}
+			if(s->closing && !s->out_size) {
+				session_close(n-1);
+			}
+		}
+		if(fds[0].revents & POLLIN) {
+			int fd;
+			while((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+				session_open(fd);
+			}
+		}
+	}
+}
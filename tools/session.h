@@ -0,0 +1,78 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CHIP8_SESSION_H
+#define CHIP8_SESSION_H
+
+// Protocol between chip8-server and its clients over a stream Unix domain socket.
+//
+// Each message is: type (1 byte), payload size (2 bytes, little-endian), payload. All integers are little-endian.
+//
+// SESSION_MSG_FRAME, server to client, once per emulated frame unless the client is falling behind:
+//   frame number (4 bytes), checksum of the whole display (4 bytes, chip8_display_checksum()),
+//   high_res (1 byte), sound on (1 byte), delta against the display after the previous FRAME (see delta.h)
+// The frame number skips when the server coalesces frames for a slow client. The delta is still against what
+// the client has, so the display stays intact.
+//
+// SESSION_MSG_HALT, server to client, right before the server closes the session:
+//   periph.requests (4 bytes)
+//
+// SESSION_MSG_KEYS, client to server, whenever the keys change:
+//   key_held (2 bytes)
+
+#include "delta.h"
+
+#define SESSION_MSG_FRAME (1U)
+#define SESSION_MSG_HALT (2U)
+#define SESSION_MSG_KEYS (3U)
+
+#define SESSION_HEADER_SIZE (3U)
+#define SESSION_FRAME_HEADER_SIZE (10U)
+#define SESSION_MAX_MESSAGE_SIZE (SESSION_HEADER_SIZE+SESSION_FRAME_HEADER_SIZE+CHIP8_DELTA_MAX_SIZE)
+
+static inline void session_put_u16(uint8_t *p, uint16_t value) {
+	p[0] = value;
+	p[1] = value >> 8;
+}
+
+static inline void session_put_u32(uint8_t *p, uint32_t value) {
+	p[0] = value;
+	p[1] = value >> 8;
+	p[2] = value >> 16;
+	p[3] = value >> 24;
+}
+
+static inline uint16_t session_get_u16(const uint8_t *p) {
+	return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t session_get_u32(const uint8_t *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+#endif
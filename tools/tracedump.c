@@ -0,0 +1,102 @@
+// Copyright (c) 2025 Wong "Sadale" Cho Ching <me@sadale.net>. All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Decodes an instruction trace dumped on halt by the emulator built with TRACE=1, and prints it as disassembly.
+
+#include "disasm.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static uint16_t get_u16(const uint8_t *p) {
+	return p[0] | (p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+	return get_u16(p) | ((uint32_t)get_u16(&p[2]) << 16);
+}
+
+static void print_usage(const char *program) {
+	fprintf(stderr, "Usage: %s [options] <trace>\n", program);
+	fprintf(stderr, "\t-n count\tOnly print the last count instructions\n");
+}
+
+int main(int argc, char **argv) {
+	uint32_t limit = UINT32_MAX;
+	int opt;
+	while((opt = getopt(argc, argv, "n:")) != -1) {
+		switch(opt) {
+			case 'n':
+				limit = strtoul(optarg, NULL, 0);
+			break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+	if(optind >= argc) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	FILE *fp = fopen(argv[optind], "rb");
+	if(fp == NULL) {
+		fprintf(stderr, "Failed to open the file: %s\n", argv[optind]);
+		return 1;
+	}
+	uint8_t header[CHIP8_TRACE_FILE_HEADER_SIZE];
+	if(fread(header, sizeof(header), 1, fp) != 1 || memcmp(header, "C8TRACE1", 8)) {
+		fprintf(stderr, "Not a trace file: %s\n", argv[optind]);
+		return 1;
+	}
+	uint32_t count = get_u32(&header[8]);
+	uint32_t first = get_u32(&header[12]);
+	uint32_t skip = count > limit ? count-limit : 0;
+	if(fseek(fp, (long)skip*CHIP8_TRACE_FILE_RECORD_SIZE, SEEK_CUR)) {
+		fprintf(stderr, "Failed to read the file's content: %s\n", argv[optind]);
+		return 1;
+	}
+
+	printf("%-10s %-5s %-4s %-20s %-5s %-3s %-3s\n", "#", "PC", "OP", "", "I", "VX", "VF");
+	for(uint32_t n=skip; n<count; n++) {
+		uint8_t record[CHIP8_TRACE_FILE_RECORD_SIZE];
+		if(fread(record, sizeof(record), 1, fp) != 1) {
+			fprintf(stderr, "The trace is truncated after %u records\n", n);
+			return 1;
+		}
+		uint16_t instruction = get_u16(&record[2]);
+		char mnemonic[CHIP8_DISASM_MAX_SIZE];
+		chip8_disassemble(instruction, mnemonic, sizeof(mnemonic));
+		printf("%-10u %04x  %04x %-20s %04x  %02x  %02x\n", first+n, get_u16(&record[0]), instruction, mnemonic,
+			get_u16(&record[4]), record[6], record[7]);
+	}
+	fclose(fp);
+	return 0;
+}